@@ -40,19 +40,37 @@
         "src/process.cc",
         "src/spawn.cc",
         "src/icon.cc",
+        "src/frontmost_watcher.cc",
         "src/session.cc",
         "src/script.cc",
         "src/events.cc",
+        "src/message_filter.cc",
+        "src/idle_watcher.cc",
+        "src/heap_walker.cc",
+        "src/reference_scanner.cc",
+        "src/string_scanner.cc",
         "src/glib_object.cc",
         "src/runtime.cc",
         "src/uv_context.cc",
         "src/glib_context.cc",
       ],
+      "conditions": [
+        ["OS=='linux' and target_arch=='x64'", {
+          "sources": [
+            "src/eh_frame.cc",
+            "src/unwinder.cc",
+          ],
+          "defines": [
+            "HAVE_UNWINDER",
+          ],
+        }],
+      ],
       "target_conditions": [
         ["OS=='win'", {
           "include_dirs": [
             "$(FRIDA)/build/tmp-windows/<(frida_host_msvs)/frida-core",
             "$(FRIDA)/build/sdk-windows/<(frida_host_msvs)/include/gee-0.8",
+            "$(FRIDA)/build/sdk-windows/<(frida_host_msvs)/include/json-glib-1.0",
             "$(FRIDA)/build/sdk-windows/<(frida_host_msvs)/include/glib-2.0",
             "$(FRIDA)/build/sdk-windows/<(frida_host_msvs)/lib/glib-2.0/include",
             "<!(node -e \"require(\'nan\')\")",
@@ -64,6 +82,7 @@
           "libraries": [
             "-lfrida-core.lib",
             "-lgee-0.8.lib",
+            "-ljson-glib-1.0.lib",
             "-lgio-2.0.lib",
             "-lgthread-2.0.lib",
             "-lgobject-2.0.lib",
@@ -84,6 +103,7 @@
           "include_dirs": [
             "$(FRIDA)/build/frida-<(frida_host)/include/frida-1.0",
             "$(FRIDA)/build/sdk-<(frida_host)/include/glib-2.0",
+            "$(FRIDA)/build/sdk-<(frida_host)/include/json-glib-1.0",
             "$(FRIDA)/build/sdk-<(frida_host)/lib/glib-2.0/include",
             "<!(node -e \"require(\'nan\')\")",
           ],
@@ -95,6 +115,7 @@
             "-lfrida-core-1.0",
             "-lfrida-gum-1.0",
             "-lgee-0.8",
+            "-ljson-glib-1.0",
             "-lgio-2.0",
             "-lgthread-2.0",
             "-lgobject-2.0",
@@ -0,0 +1,77 @@
+'use strict';
+
+exports.prepend = prepend;
+
+exports.append = append;
+
+exports.decodeBase64 = decodeBase64;
+
+
+/*
+ * Injects `fn(args...)` ahead of the user's code, kept on the first line
+ * after any 'use strict' directive so line numbers in the user's source
+ * are unaffected. The function must not rely on line comments or ASI, as
+ * its source is folded onto a single line. Any `helpers` are declared in a
+ * scope private to `fn`.
+ */
+function prepend(source, fn, args, helpers) {
+  var body = '(' + fold(fn) + ')';
+  if (helpers !== undefined && helpers.length > 0) {
+    body = '(function () { ' + helpers.map(fold).join(' ') +
+        ' return ' + fold(fn) + '; })()';
+  }
+  var shim = body + '(' +
+      args.map(function (arg) {
+        return JSON.stringify(arg);
+      }).join(', ') + ');';
+
+  var directive = /^\s*(['"])use strict\1;?/.exec(source);
+  if (directive !== null) {
+    var end = directive[0].length;
+    return source.substring(0, end) + ' ' + shim + source.substring(end);
+  }
+  return shim + ' ' + source;
+}
+
+/*
+ * Declares `helpers` at the end of the source, where they neither shift
+ * line numbers nor need to be folded.
+ */
+function append(source, helpers) {
+  return source + '\n' + helpers.map(function (helper) {
+    return helper.toString();
+  }).join('\n') + '\n';
+}
+
+function fold(fn) {
+  return fn.toString().replace(/\s*\n\s*/g, ' ');
+}
+
+/*
+ * Agent-side base64 decoder shared by the shims and the session helper;
+ * host-to-agent messages can only carry JSON in this tree.
+ */
+function decodeBase64(string) {
+  var length = string.length;
+  while (length > 0 && string[length - 1] === '=') {
+    length--;
+  }
+  var bytes = new Uint8Array(Math.floor(length * 3 / 4));
+  var accumulator = 0;
+  var bits = 0;
+  var offset = 0;
+  for (var i = 0; i !== length; i++) {
+    var c = string.charCodeAt(i);
+    var value = (c >= 97) ? c - 71 :
+        (c >= 65) ? c - 65 :
+        (c >= 48) ? c + 4 :
+        (c === 43) ? 62 : 63;
+    accumulator = ((accumulator << 6) | value) & 0xffffff;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      bytes[offset++] = (accumulator >> bits) & 0xff;
+    }
+  }
+  return bytes;
+}
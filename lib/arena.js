@@ -0,0 +1,197 @@
+'use strict';
+
+module.exports = Arena;
+
+
+var ptr = require('./ptr');
+var request = Symbol('request');
+var id = Symbol('id');
+var chunkSize = Symbol('chunkSize');
+var chunks = Symbol('chunks');
+var freeLists = Symbol('freeLists');
+var sizeClassOf = Symbol('sizeClassOf');
+var writes = Symbol('writes');
+var released = Symbol('released');
+var bump = Symbol('bump');
+
+var DEFAULT_CHUNK_SIZE = 64 * 1024;
+var DEFAULT_ALIGNMENT = 16;
+var MIN_SIZE_CLASS = 16;
+var MAX_SIZE_CLASS = 4096;
+
+/*
+ * Remote memory that is reserved in large chunks and carved up locally, so
+ * allocations cost no round trips and writes are shipped in one batch on
+ * flush(). Small blocks are rounded up to power-of-two size classes and
+ * recycled by free(); everything else is bump-allocated. Freeing a block
+ * that is not live, including a second free(), is ignored. release() drops
+ * all chunks at once.
+ */
+function Arena(session, sessionRequest, options) {
+  options = options || {};
+
+  Object.defineProperty(this, request, {
+    value: session[sessionRequest].bind(session)
+  });
+
+  this[id] = null;
+  this[chunkSize] = options.chunkSize || DEFAULT_CHUNK_SIZE;
+  this[chunks] = [];
+  this[freeLists] = {};
+  this[sizeClassOf] = {};
+  this[writes] = [];
+  this[released] = false;
+}
+
+Arena.prototype.reserve = function (size) {
+  if (this[released])
+    return Promise.reject(new Error('Arena has been released'));
+
+  var granularity = this[chunkSize];
+  var total = Math.max(size || 0, granularity);
+  total = Math.ceil(total / granularity) * granularity;
+
+  return this[request]('memory:alloc', {
+    arena: this[id],
+    sizes: [total]
+  })
+  .then(function (reply) {
+    var result = ptr.unpackReply(reply);
+    this[id] = result.payload.arena;
+    this[chunks].push({
+      base: result.addresses[0],
+      size: total,
+      offset: 0
+    });
+  }.bind(this));
+};
+
+Arena.prototype.alloc = function (size, options) {
+  if (this[released])
+    throw new Error('Arena has been released');
+  var alignment = (options && options.alignment) || DEFAULT_ALIGNMENT;
+
+  if (size <= MAX_SIZE_CLASS && alignment <= DEFAULT_ALIGNMENT) {
+    var sizeClass = MIN_SIZE_CLASS;
+    while (sizeClass < size)
+      sizeClass *= 2;
+
+    var free = this[freeLists][sizeClass];
+    var address = (free !== undefined && free.length > 0)
+        ? free.pop()
+        : this[bump](sizeClass, alignment);
+    this[sizeClassOf][address.toString(16)] = sizeClass;
+    return address;
+  }
+
+  return this[bump](size, alignment);
+};
+
+Arena.prototype.free = function (address) {
+  var key = address.toString(16);
+  var sizeClass = this[sizeClassOf][key];
+  if (sizeClass === undefined)
+    return;
+  delete this[sizeClassOf][key];
+  var free = this[freeLists][sizeClass];
+  if (free === undefined) {
+    free = [];
+    this[freeLists][sizeClass] = free;
+  }
+  free.push(address);
+};
+
+Arena.prototype.write = function (address, data) {
+  if (typeof data === 'string')
+    data = new Buffer(data, 'utf8');
+  else if (!Buffer.isBuffer(data))
+    data = new Buffer(data);
+  this[writes].push({
+    address: address,
+    data: data,
+    seq: this[writes].length
+  });
+};
+
+Arena.prototype.allocBytes = function (data) {
+  if (!Buffer.isBuffer(data))
+    data = new Buffer(data);
+  var address = this.alloc(data.length);
+  this.write(address, data);
+  return address;
+};
+
+Arena.prototype.allocUtf8String = function (string) {
+  var data = new Buffer(string + '\0', 'utf8');
+  return this.allocBytes(data);
+};
+
+Arena.prototype.flush = function () {
+  var pending = this[writes];
+  if (pending.length === 0)
+    return Promise.resolve();
+  this[writes] = [];
+
+  pending.sort(function (a, b) {
+    return a.address.compare(b.address) || (a.seq - b.seq);
+  });
+
+  var batch = [];
+  var buffers = [];
+  var offset = 0;
+  var current = null;
+  pending.forEach(function (w) {
+    if (current !== null &&
+        current.end.equals(w.address)) {
+      current.length += w.data.length;
+      current.end = current.end.add(w.data.length);
+    } else {
+      current = {
+        address: w.address,
+        offset: offset,
+        length: w.data.length,
+        end: w.address.add(w.data.length)
+      };
+      batch.push(current);
+    }
+    buffers.push(w.data);
+    offset += w.data.length;
+  });
+
+  return this[request]('memory:write-batch', {
+    data: Buffer.concat(buffers, offset).toString('base64'),
+    writes: batch.map(function (w) {
+      return ['0x' + w.address.toString(16), w.offset, w.length];
+    })
+  });
+};
+
+Arena.prototype.release = function () {
+  if (this[released])
+    return Promise.resolve();
+  this[released] = true;
+  this[chunks] = [];
+  this[freeLists] = {};
+  this[sizeClassOf] = {};
+  this[writes] = [];
+
+  if (this[id] === null)
+    return Promise.resolve();
+  return this[request]('memory:free', { arena: this[id] });
+};
+
+Arena.prototype[bump] = function (size, alignment) {
+  var list = this[chunks];
+  for (var i = 0; i !== list.length; i++) {
+    var chunk = list[i];
+    var start = chunk.base.add(chunk.offset);
+    var padding = start.mod(alignment).toJSNumber();
+    if (padding !== 0)
+      padding = alignment - padding;
+    if (chunk.offset + padding + size <= chunk.size) {
+      chunk.offset += padding + size;
+      return start.add(padding);
+    }
+  }
+  throw new Error('Arena exhausted; reserve() more space first');
+};
@@ -0,0 +1,95 @@
+'use strict';
+
+exports.install = install;
+
+exports.isBatch = isBatch;
+
+exports.unpack = unpack;
+
+
+var agentShim = require('./agent_shim');
+
+var BATCH_TAG = 'frida:batch';
+var DEFAULT_WINDOW = 0;
+
+/*
+ * Prepends an agent-side shim that coalesces send() calls made within
+ * `window` ms (the same tick by default) into one transport message.
+ */
+function install(source, options) {
+  var window = (options && typeof options.window === 'number')
+      ? options.window
+      : DEFAULT_WINDOW;
+  return agentShim.prepend(source, installSendBatching, [BATCH_TAG, window]);
+}
+
+function isBatch(payload) {
+  return payload instanceof Array && payload[0] === BATCH_TAG;
+}
+
+/*
+ * Expands a batch into its individual [payload, data] pairs, slicing each
+ * entry's data out of the shared blob just like unbatched delivery would.
+ */
+function unpack(payload, data) {
+  return payload[1].map(function (entry) {
+    var length = Math.max(entry[2], 0);
+    return [entry[0], data.slice(entry[1], entry[1] + length)];
+  });
+}
+
+/* jshint ignore:start */
+function installSendBatching(tag, window) {
+  var global = Function('return this')();
+  var originalSend = global.send;
+  var queue = [];
+  var scheduled = false;
+
+  function flush() {
+    scheduled = false;
+    var items = queue;
+    queue = [];
+    if (items.length === 1) {
+      originalSend(items[0][0], items[0][1]);
+      return;
+    }
+
+    var entries = [];
+    var chunks = [];
+    var total = 0;
+    items.forEach(function (item) {
+      var data = item[1];
+      var length = -1;
+      if (data !== null) {
+        var bytes = new Uint8Array(data);
+        chunks.push(bytes);
+        length = bytes.length;
+      }
+      entries.push([item[0], total, length]);
+      if (length > 0) {
+        total += length;
+      }
+    });
+
+    var blob = null;
+    if (total > 0) {
+      var buffer = new Uint8Array(total);
+      var offset = 0;
+      chunks.forEach(function (bytes) {
+        buffer.set(bytes, offset);
+        offset += bytes.length;
+      });
+      blob = buffer.buffer;
+    }
+    originalSend([tag, entries], blob);
+  }
+
+  global.send = function (message, data) {
+    queue.push([message, (data === undefined) ? null : data]);
+    if (!scheduled) {
+      scheduled = true;
+      setTimeout(flush, window);
+    }
+  };
+}
+/* jshint ignore:end */
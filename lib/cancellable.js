@@ -0,0 +1,54 @@
+'use strict';
+
+exports.track = track;
+
+exports.compose = compose;
+
+
+var DEFAULT_REASON = 'Operation was cancelled';
+var TIMEOUT_REASON = 'Operation timed out';
+
+function track(operation, options) {
+  var timeout = (options && options.timeout) || 0;
+  if (timeout > 0) {
+    var timer = setTimeout(function () {
+      operation.abort(TIMEOUT_REASON);
+    }, timeout);
+    var clear = function () {
+      clearTimeout(timer);
+    };
+    operation.then(clear, clear);
+  }
+  return operation;
+}
+
+function compose(options, body) {
+  var current = null;
+  var reason = null;
+
+  function step(operation) {
+    if (reason !== null)
+      operation.abort(reason);
+    else
+      current = operation;
+    return operation;
+  }
+
+  var rejectEarly;
+  var promise = new Promise(function (resolve, reject) {
+    rejectEarly = reject;
+    body(step).then(resolve, reject);
+  });
+  Object.defineProperty(promise, 'abort', {
+    value: function (why) {
+      if (reason !== null)
+        return;
+      reason = why || DEFAULT_REASON;
+      if (current !== null)
+        current.abort(reason);
+      rejectEarly(new Error(reason));
+    }
+  });
+
+  return track(promise, options);
+}
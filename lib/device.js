@@ -3,13 +3,18 @@
 module.exports = Device;
 
 
+var cancellable = require('./cancellable');
 var Minimatch = require('minimatch').Minimatch;
 var Session = require('./session');
 var $ = Symbol('impl');
 var getPid = Symbol('getPid');
+var moduleRegistry = Symbol('moduleRegistry');
 
-function Device(impl) {
+var DEFAULT_FRONTMOST_INTERVAL = 250;
+
+function Device(impl, registry) {
   Object.defineProperty(this, $, { value: impl });
+  Object.defineProperty(this, moduleRegistry, { value: registry });
 
   ['id', 'name', 'icon', 'type', 'events'].forEach(function (prop) {
     Object.defineProperty(this, prop,
@@ -17,21 +22,31 @@ function Device(impl) {
   }, this);
 }
 
-Device.prototype.getFrontmostApplication = function () {
-  return this[$].getFrontmostApplication();
+Device.prototype.getFrontmostApplication = function (options) {
+  return cancellable.track(this[$].getFrontmostApplication(), options);
+};
+
+Device.prototype.watchFrontmostApplication = function (callback, options) {
+  var interval = (options && options.interval) || DEFAULT_FRONTMOST_INTERVAL;
+  return this[$].watchFrontmostApplication(callback, interval);
 };
 
-Device.prototype.enumerateApplications = function () {
-  return this[$].enumerateApplications();
+Device.prototype.enumerateApplications = function (options) {
+  return cancellable.track(this[$].enumerateApplications(scopeOf(options)), options);
 };
 
-Device.prototype.enumerateProcesses = function () {
-  return this[$].enumerateProcesses();
+Device.prototype.enumerateProcesses = function (options) {
+  return cancellable.track(this[$].enumerateProcesses(scopeOf(options)), options);
 };
 
-Device.prototype.getProcess = function (name) {
-  return this.enumerateProcesses()
-  .then(function (processes) {
+Device.prototype.getProcess = function (name, options) {
+  return cancellable.compose(options, function (step) {
+    return step(this.enumerateProcesses({
+      scope: scopeOf(options)
+    })).then(selectProcess);
+  }.bind(this));
+
+  function selectProcess(processes) {
     var mm = new Minimatch(name.toLowerCase());
     var matching = processes.filter(function (process) {
       return mm.match(process.name.toLowerCase());
@@ -45,53 +60,69 @@ Device.prototype.getProcess = function (name) {
     } else {
       throw new Error('Process not found');
     }
-  });
+  }
 };
 
-Device.prototype.enableSpawnGating = function () {
-  return this[$].enableSpawnGating();
+Device.prototype.enableSpawnGating = function (options) {
+  return cancellable.track(this[$].enableSpawnGating(), options);
 };
 
-Device.prototype.disableSpawnGating = function () {
-  return this[$].disableSpawnGating();
+Device.prototype.disableSpawnGating = function (options) {
+  return cancellable.track(this[$].disableSpawnGating(), options);
 };
 
-Device.prototype.enumeratePendingSpawns = function () {
-  return this[$].enumeratePendingSpawns();
+Device.prototype.enumeratePendingSpawns = function (options) {
+  return cancellable.track(this[$].enumeratePendingSpawns(), options);
 };
 
-Device.prototype.spawn = function (argv) {
-  return this[$].spawn(argv);
+Device.prototype.spawn = function (argv, options) {
+  return cancellable.track(this[$].spawn(argv), options);
 };
 
-Device.prototype.resume = function (target) {
-  return this[getPid](target).then(function (pid) {
-    return this[$].resume(pid);
+Device.prototype.resume = function (target, options) {
+  return cancellable.compose(options, function (step) {
+    return this[getPid](target, step).then(function (pid) {
+      return step(this[$].resume(pid));
+    }.bind(this));
   }.bind(this));
 };
 
-Device.prototype.kill = function (target) {
-  return this[getPid](target).then(function (pid) {
-    return this[$].kill(pid);
+Device.prototype.kill = function (target, options) {
+  return cancellable.compose(options, function (step) {
+    return this[getPid](target, step).then(function (pid) {
+      return step(this[$].kill(pid));
+    }.bind(this));
   }.bind(this));
 };
 
-Device.prototype.attach = function (target) {
-  return this[getPid](target)
-  .then(function (pid) {
-    return this[$].attach(pid);
-  }.bind(this))
-  .then(function (impl) {
-    return new Session(impl);
-  });
+Device.prototype.attach = function (target, options) {
+  return cancellable.compose(options, function (step) {
+    return this[getPid](target, step)
+    .then(function (pid) {
+      return step(this[$].attach(pid));
+    }.bind(this))
+    .then(function (impl) {
+      var session = new Session(impl, this[moduleRegistry]);
+      // The warm-up is not waited for, but its outcome is kept as
+      // session.warmedUp. It is observed here so that not looking at it
+      // does not leave a rejection unhandled.
+      var warmedUp = (options && options.warmup)
+          ? session.warmUp(options.warmup)
+          : Promise.resolve();
+      warmedUp.catch(function () {
+      });
+      Object.defineProperty(session, 'warmedUp', { value: warmedUp });
+      return session;
+    }.bind(this));
+  }.bind(this));
 };
 
-Device.prototype[getPid] = function (target) {
+Device.prototype[getPid] = function (target, step) {
   return new Promise(function (resolve, reject) {
     if (typeof target === 'number') {
       resolve(target);
     } else {
-      this.getProcess(target)
+      step(this.getProcess(target, { scope: 'minimal' }))
       .then(function (process) {
         resolve(process.pid);
       })
@@ -99,3 +130,7 @@ Device.prototype[getPid] = function (target) {
     }
   }.bind(this));
 };
+
+function scopeOf(options) {
+  return (options && options.scope) || 'metadata';
+}
@@ -3,19 +3,28 @@
 module.exports = DeviceManager;
 
 
+var cancellable = require('./cancellable');
 var Device = require('./device');
+var ModuleInfo = require('./module_info');
 var $ = Symbol('impl');
+var moduleRegistry = Symbol('moduleRegistry');
 
 function DeviceManager(impl) {
   Object.defineProperty(this, $, { value: impl });
 
   Object.defineProperty(this, 'events',
       Object.getOwnPropertyDescriptor(impl, 'events'));
+
+  this[moduleRegistry] = new ModuleInfo.Registry();
 }
 
-DeviceManager.prototype.enumerateDevices = function () {
-  return this[$].enumerateDevices()
-  .then(function (devices) {
-    return devices.map(function (impl) { return new Device(impl); });
-  });
+DeviceManager.prototype.enumerateDevices = function (options) {
+  return cancellable.compose(options, function (step) {
+    return step(this[$].enumerateDevices())
+    .then(function (devices) {
+      return devices.map(function (impl) {
+        return new Device(impl, this[moduleRegistry]);
+      }, this);
+    }.bind(this));
+  }.bind(this));
 };
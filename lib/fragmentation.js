@@ -0,0 +1,300 @@
+'use strict';
+
+exports.install = install;
+
+exports.isFragment = isFragment;
+
+exports.Reassembler = Reassembler;
+
+
+var agentShim = require('./agent_shim');
+
+var FRAGMENT_TAG = 'frida:fragment';
+var DEFAULT_MAX_PENDING_BYTES = 64 * 1024 * 1024;
+var DEFAULT_MAX_PENDING_AGE = 60000;
+
+/*
+ * Prepends an agent-side shim that splits any send() whose UTF-8 encoded
+ * JSON plus data exceeds `fragmentSize` bytes into fragments of at most
+ * that many bytes of each. Fragments go out one per turn of the agent's
+ * event loop, so other traffic interleaves with them; later messages
+ * queue up behind to keep order.
+ *
+ * Most messages are small, so an upper bound on their size is estimated
+ * from a short walk over the message first, and only messages that might
+ * be too large are serialized up front to be measured exactly.
+ */
+function install(source, fragmentSize) {
+  return agentShim.prepend(source, installSendFragmentation,
+      [FRAGMENT_TAG, fragmentSize]);
+}
+
+function isFragment(payload) {
+  return payload instanceof Array && payload[0] === FRAGMENT_TAG;
+}
+
+/*
+ * Partial messages are dropped once they have waited more than
+ * `maxPendingAge` milliseconds for their remaining fragments, and, oldest
+ * first, whenever more than `maxPendingBytes` are held in total; a message
+ * whose agent went away mid-send would otherwise be kept for ever.
+ */
+function Reassembler(options) {
+  options = options || {};
+
+  this.pending = {};
+  this.pendingBytes = 0;
+  this.maxPendingBytes = (options.maxPendingBytes !== undefined)
+      ? options.maxPendingBytes
+      : DEFAULT_MAX_PENDING_BYTES;
+  this.maxPendingAge = (options.maxPendingAge !== undefined)
+      ? options.maxPendingAge
+      : DEFAULT_MAX_PENDING_AGE;
+}
+
+/*
+ * Returns [payload, data] once the last fragment of a message is in, and
+ * null before that.
+ */
+Reassembler.prototype.add = function (payload, data) {
+  var id = payload[1];
+  var index = payload[2];
+  var count = payload[3];
+  var now = Date.now();
+
+  this.evictStale(now);
+
+  var message = this.pending[id];
+  if (message === undefined) {
+    message = {
+      json: new Array(count),
+      data: new Array(count),
+      received: 0,
+      bytes: 0,
+      started: now
+    };
+    this.pending[id] = message;
+  }
+  if (index >= message.json.length || message.json[index] !== undefined)
+    return null;
+
+  var bytes = Buffer.byteLength(payload[4]) + data.length;
+  message.json[index] = payload[4];
+  message.data[index] = data;
+  message.bytes += bytes;
+  this.pendingBytes += bytes;
+  if (++message.received !== count) {
+    this.evictOverflow();
+    return null;
+  }
+
+  this.evict(id);
+  return [
+    JSON.parse(message.json.join('')),
+    Buffer.concat(message.data)
+  ];
+};
+
+Reassembler.prototype.clear = function () {
+  this.pending = {};
+  this.pendingBytes = 0;
+};
+
+Reassembler.prototype.evict = function (id) {
+  this.pendingBytes -= this.pending[id].bytes;
+  delete this.pending[id];
+};
+
+Reassembler.prototype.evictStale = function (now) {
+  var pending = this.pending;
+  Object.keys(pending).forEach(function (id) {
+    if (now - pending[id].started > this.maxPendingAge)
+      this.evict(id);
+  }, this);
+};
+
+Reassembler.prototype.evictOverflow = function () {
+  var pending = this.pending;
+  var oldestFirst = Object.keys(pending).sort(function (a, b) {
+    return pending[a].started - pending[b].started;
+  });
+  for (var i = 0; i !== oldestFirst.length &&
+      this.pendingBytes > this.maxPendingBytes; i++) {
+    this.evict(oldestFirst[i]);
+  }
+};
+
+/* jshint ignore:start */
+function installSendFragmentation(tag, fragmentSize) {
+  var global = Function('return this')();
+  var originalSend = global.send;
+  var queue = [];
+  var pumping = false;
+  var nextId = 1;
+
+  var MAX_ESTIMATED_NODES = 256;
+
+  function split(message, data) {
+    var bytes = (data !== null) ? new Uint8Array(data) : null;
+    var dataLength = (bytes !== null) ? bytes.length : 0;
+    if (dataLength <= fragmentSize &&
+        fitsWithin(message, fragmentSize - dataLength)) {
+      return null;
+    }
+
+    var json = JSON.stringify(message);
+    if (utf8Length(json) + dataLength <= fragmentSize) {
+      return null;
+    }
+
+    var pieces = splitUtf8(json, fragmentSize);
+    var count = Math.max(pieces.length, Math.ceil(dataLength / fragmentSize));
+    var id = nextId++;
+    var fragments = [];
+    for (var i = 0; i !== count; i++) {
+      var start = i * fragmentSize;
+      var piece = null;
+      if (start < dataLength) {
+        piece = new Uint8Array(
+            bytes.subarray(start, start + fragmentSize)).buffer;
+      }
+      fragments.push([[tag, id, i, count,
+          (i < pieces.length) ? pieces[i] : ''], piece]);
+    }
+    return fragments;
+  }
+
+  function fitsWithin(message, budget) {
+    var remaining = budget;
+    var pending = [message];
+    var nodes = 0;
+    while (pending.length > 0) {
+      var value = pending.pop();
+      if (++nodes > MAX_ESTIMATED_NODES) {
+        return false;
+      }
+      if (typeof value === 'string') {
+        remaining -= 6 * value.length + 2;
+      } else if (typeof value === 'number') {
+        remaining -= 24;
+      } else if (value === null || typeof value !== 'object') {
+        remaining -= 5;
+      } else if (typeof value.toJSON === 'function') {
+        return false;
+      } else if (value instanceof Array) {
+        remaining -= 2 + value.length;
+        for (var i = 0; i !== value.length; i++) {
+          pending.push(value[i]);
+        }
+      } else {
+        var keys = Object.keys(value);
+        remaining -= 2;
+        for (var j = 0; j !== keys.length; j++) {
+          remaining -= 6 * keys[j].length + 4;
+          pending.push(value[keys[j]]);
+        }
+      }
+      if (remaining < 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  function utf8Length(string) {
+    var length = 0;
+    for (var i = 0; i !== string.length; i++) {
+      var c = string.charCodeAt(i);
+      if (c < 0x80) {
+        length += 1;
+      } else if (c < 0x800) {
+        length += 2;
+      } else if (isSurrogatePair(string, i)) {
+        length += 4;
+        i++;
+      } else {
+        length += 3;
+      }
+    }
+    return length;
+  }
+
+  function splitUtf8(json, limit) {
+    var pieces = [];
+    var start = 0;
+    var size = 0;
+    var i = 0;
+    while (i < json.length) {
+      var c = json.charCodeAt(i);
+      var units = 1;
+      var n;
+      if (c === 0x22 || c === 0x5c) {
+        n = 2;
+      } else if (c < 0x20) {
+        n = 6;
+      } else if (c < 0x80) {
+        n = 1;
+      } else if (c < 0x800) {
+        n = 2;
+      } else if (isSurrogatePair(json, i)) {
+        n = 4;
+        units = 2;
+      } else if (c >= 0xd800 && c <= 0xdfff) {
+        n = 6;
+      } else {
+        n = 3;
+      }
+      if (size + n > limit && size > 0) {
+        pieces.push(json.substring(start, i));
+        start = i;
+        size = 0;
+      }
+      size += n;
+      i += units;
+    }
+    pieces.push(json.substring(start));
+    return pieces;
+  }
+
+  function isSurrogatePair(string, i) {
+    var c = string.charCodeAt(i);
+    return c >= 0xd800 && c <= 0xdbff && i + 1 < string.length &&
+        (string.charCodeAt(i + 1) & 0xfc00) === 0xdc00;
+  }
+
+  function pump() {
+    while (queue.length > 0) {
+      var item = queue[0];
+      if (item.fragments === null) {
+        queue.shift();
+        originalSend(item.message, item.data);
+        continue;
+      }
+      var fragment = item.fragments.shift();
+      originalSend(fragment[0], fragment[1]);
+      if (item.fragments.length === 0) {
+        queue.shift();
+      }
+      setTimeout(pump, 0);
+      return;
+    }
+    pumping = false;
+  }
+
+  global.send = function (message, data) {
+    if (data === undefined) {
+      data = null;
+    }
+    var fragments = split(message, data);
+    if (fragments === null && !pumping) {
+      originalSend(message, data);
+      return;
+    }
+    queue.push({ message: message, data: data, fragments: fragments });
+    if (!pumping) {
+      pumping = true;
+      pump();
+    }
+  };
+}
+/* jshint ignore:end */
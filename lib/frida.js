@@ -1,26 +1,34 @@
 'use strict';
 
-exports.spawn = function (argv) {
-  return getLocalDevice().then(function (device) {
-    return device.spawn(argv);
+exports.spawn = function (argv, options) {
+  return cancellable.compose(options, function (step) {
+    return getLocalDevice().then(function (device) {
+      return step(device.spawn(argv, options));
+    });
   });
 };
 
-exports.resume = function (target) {
-  return getLocalDevice().then(function (device) {
-    return device.resume(target);
+exports.resume = function (target, options) {
+  return cancellable.compose(options, function (step) {
+    return getLocalDevice().then(function (device) {
+      return step(device.resume(target, options));
+    });
   });
 };
 
-exports.kill = function (target) {
-  return getLocalDevice().then(function (device) {
-    return device.kill(target);
+exports.kill = function (target, options) {
+  return cancellable.compose(options, function (step) {
+    return getLocalDevice().then(function (device) {
+      return step(device.kill(target, options));
+    });
   });
 };
 
-exports.attach = function (target) {
-  return getLocalDevice().then(function (device) {
-    return device.attach(target);
+exports.attach = function (target, options) {
+  return cancellable.compose(options, function (step) {
+    return getLocalDevice().then(function (device) {
+      return step(device.attach(target, options));
+    });
   });
 };
 
@@ -40,8 +48,11 @@ exports.getDeviceManager = getDeviceManager;
 
 exports.ptr = require('./ptr');
 
+exports.SnapshotStore = require('./snapshot_store');
+
 
 var binding = require('bindings')('frida_binding');
+var cancellable = require('./cancellable');
 var DeviceManager = require('./device_manager');
 var deviceManager = null;
 
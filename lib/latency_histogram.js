@@ -0,0 +1,68 @@
+'use strict';
+
+module.exports = LatencyHistogram;
+
+
+var SUB_BUCKETS = 8;
+
+/*
+ * Log-linear histogram matching the agent's bucketing: values below 16 ns
+ * get a bucket each, above that every power of two is split into eight
+ * linear sub-buckets (12.5% relative error).
+ */
+function LatencyHistogram() {
+  this.counts = {};
+  this.count = 0;
+  this.sum = 0;
+  this.max = 0;
+}
+
+LatencyHistogram.prototype.merge = function (other) {
+  Object.keys(other.counts).forEach(function (bucket) {
+    this.counts[bucket] = (this.counts[bucket] || 0) + other.counts[bucket];
+  }, this);
+  this.count += other.count;
+  this.sum += other.sum;
+  this.max = Math.max(this.max, other.max);
+};
+
+LatencyHistogram.prototype.add = function (bucket, count) {
+  this.counts[bucket] = (this.counts[bucket] || 0) + count;
+  this.count += count;
+};
+
+LatencyHistogram.prototype.percentile = function (p) {
+  if (this.count === 0)
+    return 0;
+  var rank = Math.ceil((p / 100) * this.count);
+  var buckets = Object.keys(this.counts).map(Number).sort(function (a, b) {
+    return a - b;
+  });
+  var seen = 0;
+  for (var i = 0; i !== buckets.length; i++) {
+    seen += this.counts[buckets[i]];
+    if (seen >= rank)
+      return Math.min(bucketMidpoint(buckets[i]), this.max);
+  }
+  return this.max;
+};
+
+LatencyHistogram.prototype.toJSON = function () {
+  return {
+    count: this.count,
+    mean: this.count > 0 ? this.sum / this.count : 0,
+    p50: this.percentile(50),
+    p90: this.percentile(90),
+    p99: this.percentile(99),
+    max: this.max
+  };
+};
+
+function bucketMidpoint(bucket) {
+  if (bucket < 2 * SUB_BUCKETS)
+    return bucket;
+  var shift = Math.floor(bucket / SUB_BUCKETS) - 1;
+  var mantissa = bucket - shift * SUB_BUCKETS;
+  var width = Math.pow(2, shift);
+  return mantissa * width + width / 2;
+}
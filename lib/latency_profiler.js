@@ -0,0 +1,88 @@
+'use strict';
+
+module.exports = LatencyProfiler;
+
+
+var LatencyHistogram = require('./latency_histogram');
+var request = Symbol('request');
+var id = Symbol('id');
+var unsubscribe = Symbol('unsubscribe');
+var onFlush = Symbol('onFlush');
+var histograms = Symbol('histograms');
+var callback = Symbol('callback');
+
+function LatencyProfiler(session, sessionRequest, sessionSubscribe,
+    profilerId, topic, targets, options) {
+  Object.defineProperty(this, request, {
+    value: session[sessionRequest].bind(session)
+  });
+
+  Object.defineProperty(this, 'targets', {
+    enumerable: true,
+    value: targets
+  });
+
+  this[id] = profilerId;
+  this[histograms] = targets.map(function () {
+    return {};
+  });
+  this[callback] = (options && options.onFlush) || null;
+  this[unsubscribe] = session[sessionSubscribe](topic, this[onFlush].bind(this));
+}
+
+/*
+ * Per-function latency statistics in nanoseconds. Each entry aggregates all
+ * threads and also carries the per-thread breakdown.
+ */
+LatencyProfiler.prototype.getStats = function () {
+  return this.targets.map(function (target, index) {
+    var perThread = this[histograms][index];
+    var total = new LatencyHistogram();
+    var threads = {};
+    Object.keys(perThread).forEach(function (threadId) {
+      total.merge(perThread[threadId]);
+      threads[threadId] = perThread[threadId].toJSON();
+    });
+    var stats = total.toJSON();
+    stats.target = target;
+    stats.threads = threads;
+    return stats;
+  }, this);
+};
+
+LatencyProfiler.prototype.stop = function () {
+  return this[request]('profile:latency-stop', { id: this[id] })
+  .then(function () {
+    this[unsubscribe]();
+    return this.getStats();
+  }.bind(this));
+};
+
+LatencyProfiler.prototype[onFlush] = function (payload, data) {
+  var count = data.readUInt32LE(0);
+  var offset = 4;
+  for (var i = 0; i !== count; i++) {
+    var index = data.readUInt32LE(offset);
+    var threadId = data.readUInt32LE(offset + 4);
+    var buckets = data.readUInt32LE(offset + 8);
+    var sum = data.readDoubleLE(offset + 16);
+    var max = data.readDoubleLE(offset + 24);
+    offset += 32;
+
+    var perThread = this[histograms][index];
+    var histogram = perThread[threadId];
+    if (histogram === undefined) {
+      histogram = new LatencyHistogram();
+      perThread[threadId] = histogram;
+    }
+    for (var j = 0; j !== buckets; j++) {
+      histogram.add(data.readUInt32LE(offset), data.readUInt32LE(offset + 4));
+      offset += 8;
+    }
+    histogram.sum += sum;
+    histogram.max = Math.max(histogram.max, max);
+  }
+
+  if (this[callback] !== null)
+    this[callback](this);
+};
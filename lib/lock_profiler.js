@@ -0,0 +1,153 @@
+'use strict';
+
+module.exports = LockProfiler;
+
+
+var bigInt = require('big-integer');
+var Symbolicator = require('./symbolicator');
+var request = Symbol('request');
+var id = Symbol('id');
+var unsubscribe = Symbol('unsubscribe');
+var onFlush = Symbol('onFlush');
+var sites = Symbol('sites');
+var symbolicator = Symbol('symbolicator');
+
+var KINDS = ['mutex', 'rwlock', 'cond'];
+
+function LockProfiler(session, sessionRequest, sessionSubscribe, profilerId,
+    topic) {
+  Object.defineProperty(this, request, {
+    value: session[sessionRequest].bind(session)
+  });
+
+  this[id] = profilerId;
+  this[sites] = {};
+  this[symbolicator] = new Symbolicator(session);
+  this[unsubscribe] = session[sessionSubscribe](topic, this[onFlush].bind(this));
+}
+
+/*
+ * Resolves to the most contended locks, ordered by total wait time, each
+ * with its symbolicated acquiring call sites. Times are in nanoseconds.
+ */
+LockProfiler.prototype.getReport = function (options) {
+  var limit = (options && options.limit) || 10;
+
+  var locks = {};
+  Object.keys(this[sites]).forEach(function (key) {
+    var site = this[sites][key];
+    var lockKey = site.lock.toString(16);
+    var lock = locks[lockKey];
+    if (lock === undefined) {
+      lock = {
+        address: site.lock,
+        kind: site.kind,
+        acquisitions: 0,
+        contended: 0,
+        waitTime: 0,
+        maxWait: 0,
+        holdTime: 0,
+        maxHold: 0,
+        sites: []
+      };
+      locks[lockKey] = lock;
+    }
+    accumulate(lock, site);
+    lock.sites.push(site);
+  }, this);
+
+  var top = Object.keys(locks).map(function (key) {
+    return locks[key];
+  }).sort(function (a, b) {
+    return b.waitTime - a.waitTime;
+  }).slice(0, limit);
+
+  var addresses = [];
+  top.forEach(function (lock) {
+    lock.sites.sort(function (a, b) {
+      return b.waitTime - a.waitTime;
+    });
+    lock.sites.forEach(function (site) {
+      addresses.push(site.address);
+    });
+  });
+
+  return this[symbolicator].symbolicate(addresses).then(function (symbols) {
+    var index = 0;
+    return top.map(function (lock) {
+      lock.sites = lock.sites.map(function (site) {
+        var result = copyStats(site);
+        result.callSite = symbols[index++];
+        return result;
+      });
+      return lock;
+    });
+  });
+};
+
+LockProfiler.prototype.stop = function (options) {
+  return this[request]('profile:locks-stop', { id: this[id] })
+  .then(function () {
+    this[unsubscribe]();
+    return this.getReport(options);
+  }.bind(this));
+};
+
+LockProfiler.prototype[onFlush] = function (payload, data) {
+  var count = data.readUInt32LE(0);
+  var offset = 4;
+  for (var i = 0; i !== count; i++) {
+    var lock = readU64(data, offset);
+    var address = readU64(data, offset + 8);
+    var key = lock.toString(16) + ':' + address.toString(16);
+    var site = this[sites][key];
+    if (site === undefined) {
+      site = {
+        lock: lock,
+        address: address,
+        kind: KINDS[data.readUInt32LE(offset + 16)],
+        acquisitions: 0,
+        contended: 0,
+        waitTime: 0,
+        maxWait: 0,
+        holdTime: 0,
+        maxHold: 0
+      };
+      this[sites][key] = site;
+    }
+    accumulate(site, {
+      acquisitions: data.readUInt32LE(offset + 20),
+      contended: data.readUInt32LE(offset + 24),
+      waitTime: data.readDoubleLE(offset + 32),
+      maxWait: data.readDoubleLE(offset + 40),
+      holdTime: data.readDoubleLE(offset + 48),
+      maxHold: data.readDoubleLE(offset + 56)
+    });
+    offset += 64;
+  }
+};
+
+function accumulate(target, source) {
+  target.acquisitions += source.acquisitions;
+  target.contended += source.contended;
+  target.waitTime += source.waitTime;
+  target.maxWait = Math.max(target.maxWait, source.maxWait);
+  target.holdTime += source.holdTime;
+  target.maxHold = Math.max(target.maxHold, source.maxHold);
+}
+
+function copyStats(site) {
+  return {
+    acquisitions: site.acquisitions,
+    contended: site.contended,
+    waitTime: site.waitTime,
+    maxWait: site.maxWait,
+    holdTime: site.holdTime,
+    maxHold: site.maxHold
+  };
+}
+
+function readU64(data, offset) {
+  return bigInt(data.readUInt32LE(offset + 4)).shiftLeft(32)
+      .add(data.readUInt32LE(offset));
+}
@@ -0,0 +1,94 @@
+'use strict';
+
+module.exports = Message;
+
+
+var parsed = Symbol('parsed');
+var parse = Symbol('parse');
+
+var TYPE_PREFIX = '{"type":"';
+var SEND_PREFIX = '{"type":"send","payload":';
+var RPC_PREFIX = SEND_PREFIX + '["frida:rpc"';
+var BATCH_PREFIX = SEND_PREFIX + '["frida:batch"';
+var FRAGMENT_PREFIX = SEND_PREFIX + '["frida:fragment"';
+
+function Message(json) {
+  Object.defineProperty(this, 'raw', {
+    enumerable: true,
+    value: json
+  });
+
+  this[parsed] = null;
+}
+
+Object.defineProperty(Message.prototype, 'type', {
+  enumerable: true,
+  get: function () {
+    return peekType(this.raw) || this[parse]().type;
+  }
+});
+
+Object.defineProperty(Message.prototype, 'rawPayload', {
+  get: function () {
+    var json = this.raw;
+    if (isCanonicalSend(json))
+      return json.substring(SEND_PREFIX.length, json.length - 1);
+    return JSON.stringify(this[parse]().payload);
+  }
+});
+
+['payload', 'description', 'stack', 'fileName', 'lineNumber', 'columnNumber']
+.forEach(function (name) {
+  Object.defineProperty(Message.prototype, name, {
+    enumerable: true,
+    get: function () {
+      return this[parse]()[name];
+    }
+  });
+});
+
+Message.prototype.toJSON = function () {
+  return this[parse]();
+};
+
+Message.prototype[parse] = function () {
+  if (this[parsed] === null)
+    this[parsed] = JSON.parse(this.raw);
+  return this[parsed];
+};
+
+Message.peekType = peekType;
+
+Message.isRpc = function (json) {
+  if (json.indexOf(TYPE_PREFIX) !== 0)
+    return isRpcPayload(JSON.parse(json));
+  return json.indexOf(RPC_PREFIX) === 0;
+};
+
+Message.isBatch = function (json) {
+  return json.indexOf(BATCH_PREFIX) === 0;
+};
+
+Message.isFragment = function (json) {
+  return json.indexOf(FRAGMENT_PREFIX) === 0;
+};
+
+function peekType(json) {
+  if (json.indexOf(TYPE_PREFIX) !== 0)
+    return null;
+  var end = json.indexOf('"', TYPE_PREFIX.length);
+  if (end === -1)
+    return null;
+  return json.substring(TYPE_PREFIX.length, end);
+}
+
+function isCanonicalSend(json) {
+  return json.indexOf(SEND_PREFIX) === 0 && json[json.length - 1] === '}';
+}
+
+function isRpcPayload(message) {
+  if (message.type !== 'send')
+    return false;
+  var payload = message.payload;
+  return payload instanceof Array && payload[0] === 'frida:rpc';
+}
@@ -8,15 +8,23 @@ var ModuleFunction = require('./module_function');
 var ptr = require('./ptr');
 var Range = require('./range');
 var request = Symbol('request');
+var info = Symbol('info');
 var exportsPromise = Symbol('exportsPromise');
-var functionsInitialized = Symbol('functionsInitialized');
-
-function Module(name, baseAddress, size, path, session, sessionRequest) {
+var getExportTable = Symbol('getExportTable');
+
+/*
+ * A module as loaded in one process. Everything but the base address lives
+ * in a ModuleInfo that is shared with other sessions that have the same
+ * build loaded.
+ */
+function Module(moduleInfo, baseAddress, session, sessionRequest) {
   FunctionContainer.call(this);
 
+  Object.defineProperty(this, info, { value: moduleInfo });
+
   Object.defineProperty(this, 'name', {
     enumerable: true,
-    value: name
+    value: moduleInfo.name
   });
 
   Object.defineProperty(this, 'baseAddress', {
@@ -26,12 +34,17 @@ function Module(name, baseAddress, size, path, session, sessionRequest) {
 
   Object.defineProperty(this, 'size', {
     enumerable: true,
-    value: size
+    value: moduleInfo.size
   });
 
   Object.defineProperty(this, 'path', {
     enumerable: true,
-    value: path
+    value: moduleInfo.path
+  });
+
+  Object.defineProperty(this, 'buildId', {
+    enumerable: true,
+    value: moduleInfo.buildId
   });
 
   Object.defineProperty(this, request, {
@@ -39,56 +52,48 @@ function Module(name, baseAddress, size, path, session, sessionRequest) {
   });
 
   this[exportsPromise] = null;
-
-  this[functionsInitialized] = false;
 }
 
 Module.prototype = Object.create(FunctionContainer.prototype);
 
 Module.prototype.enumerateExports = function () {
   if (this[exportsPromise] === null) {
-    this[exportsPromise] = new Promise(function (resolve, reject) {
-      this[request]('module:enumerate-exports', { modulePath: this.path })
-      .then(function (result) {
-        resolve(result.exports.map(function (e) {
-          var relativeAddress = ptr(e.address).subtract(this.baseAddress);
-          return new ModuleFunction(this, e.name, relativeAddress, true);
-        }, this));
-      }.bind(this))
-      .catch(reject);
+    this[exportsPromise] = this[getExportTable]().then(function (table) {
+      return table.names.map(function (name, i) {
+        return new ModuleFunction(this, name, table.relativeAddresses[i], true);
+      }, this);
     }.bind(this));
   }
   return this[exportsPromise];
 };
 
+Module.prototype[getExportTable] = function () {
+  return this[info].getExports(this.baseAddress, function () {
+    return this[request]('module:enumerate-exports', { modulePath: this.path })
+    .then(function (reply) {
+      var result = ptr.unpackReply(reply);
+      return [result.payload.names, result.addresses];
+    });
+  }.bind(this));
+};
+
 Module.prototype.enumerateRanges = function (protection) {
   return this[request]('module:enumerate-ranges', {
     modulePath: this.path,
     protection: protection
   })
-  .then(function (result) {
-    return result.ranges.map(function (r) {
-      return new Range(ptr(r.base), r.size, r.protection);
-    });
-  });
+  .then(Range.fromReply);
 };
 
 Module.prototype._doEnsureFunction = function (relativeAddress) {
-  return this.enumerateExports().then(function (exports) {
-    var mf;
-
-    if (!this[functionsInitialized]) {
-      for (var i = 0; i !== exports.length; i++) {
-        mf = exports[i];
-        this._functions[mf.relativeAddress.toString(16)] = mf;
-      }
-      this[functionsInitialized] = true;
-    }
-
+  return this[getExportTable]().then(function (table) {
     var id = relativeAddress.toString(16);
-    mf = this._functions[id];
+    var mf = this._functions[id];
     if (!mf) {
-      mf = new ModuleFunction(this, 'sub_' + id, relativeAddress, false);
+      var i = table.index[id];
+      mf = (i !== undefined)
+          ? new ModuleFunction(this, table.names[i], relativeAddress, true)
+          : new ModuleFunction(this, 'sub_' + id, relativeAddress, false);
       this._functions[id] = mf;
     }
     return mf;
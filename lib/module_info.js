@@ -0,0 +1,114 @@
+'use strict';
+
+module.exports = ModuleInfo;
+
+
+/*
+ * What is known about a module independently of where it is loaded: its
+ * identity, and its export table relative to the base address. Modules
+ * with a build-id are interned in a Registry, so every session that has
+ * the same build loaded shares one instance. Without a build-id there is
+ * no safe way to tell two builds apart, and each module gets its own.
+ */
+function ModuleInfo(name, path, size, buildId) {
+  Object.defineProperty(this, 'name', {
+    enumerable: true,
+    value: name
+  });
+
+  Object.defineProperty(this, 'path', {
+    enumerable: true,
+    value: path
+  });
+
+  Object.defineProperty(this, 'size', {
+    enumerable: true,
+    value: size
+  });
+
+  Object.defineProperty(this, 'buildId', {
+    enumerable: true,
+    value: buildId
+  });
+
+  this.exports = null;
+}
+
+/*
+ * Interned ModuleInfo instances, one registry per DeviceManager. Each
+ * acquire() is balanced by a release(), and an instance is dropped, along
+ * with its export table, once no session holds it anymore.
+ */
+function Registry() {
+  this.entries = {};
+}
+
+ModuleInfo.Registry = Registry;
+
+Registry.prototype.acquire = function (name, path, size, buildId) {
+  if (buildId === null)
+    return new ModuleInfo(name, path, size, null);
+
+  var key = path + '\0' + buildId;
+  var entry = this.entries[key];
+  if (entry === undefined) {
+    entry = {
+      info: new ModuleInfo(name, path, size, buildId),
+      refs: 0
+    };
+    this.entries[key] = entry;
+  }
+  entry.refs++;
+  return entry.info;
+};
+
+Registry.prototype.release = function (info) {
+  if (info.buildId === null)
+    return;
+
+  var key = info.path + '\0' + info.buildId;
+  var entry = this.entries[key];
+  if (entry === undefined || entry.info !== info)
+    return;
+  if (--entry.refs === 0)
+    delete this.entries[key];
+};
+
+/*
+ * Resolves to { names, relativeAddresses, index }, where index maps a
+ * relative address in hex to its position in the table. `fetch` resolves
+ * to [names, addresses] with absolute addresses based at `baseAddress`,
+ * and is only called when no other caller's fetch is in flight. When that
+ * other fetch fails, e.g. because its session went away, this caller
+ * retries with its own rather than sharing the failure.
+ */
+ModuleInfo.prototype.getExports = function (baseAddress, fetch) {
+  var own = false;
+  if (this.exports === null) {
+    own = true;
+    this.exports = fetch().then(function (result) {
+      var names = result[0];
+      var relativeAddresses = result[1].map(function (address) {
+        return address.subtract(baseAddress);
+      });
+      var index = {};
+      relativeAddresses.forEach(function (relativeAddress, i) {
+        index[relativeAddress.toString(16)] = i;
+      });
+      return {
+        names: names,
+        relativeAddresses: relativeAddresses,
+        index: index
+      };
+    });
+  }
+
+  var shared = this.exports;
+  return shared.catch(function (error) {
+    if (this.exports === shared)
+      this.exports = null;
+    if (own)
+      throw error;
+    return this.getExports(baseAddress, fetch);
+  }.bind(this));
+};
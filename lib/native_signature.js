@@ -0,0 +1,168 @@
+'use strict';
+
+module.exports = NativeSignature;
+
+
+var bigInt = require('big-integer');
+
+var SLOT_SIZE = 8;
+
+var TYPES = {
+  'void': { array: null, read: function () { return undefined; } },
+  'bool': { array: Int32Array, read: readInt32 },
+  'char': { array: Int8Array, read: readInt8 },
+  'uchar': { array: Uint8Array, read: readUInt8 },
+  'int8': { array: Int8Array, read: readInt8 },
+  'uint8': { array: Uint8Array, read: readUInt8 },
+  'int16': { array: Int16Array, read: readInt16 },
+  'uint16': { array: Uint16Array, read: readUInt16 },
+  'int': { array: Int32Array, read: readInt32 },
+  'uint': { array: Uint32Array, read: readUInt32 },
+  'int32': { array: Int32Array, read: readInt32 },
+  'uint32': { array: Uint32Array, read: readUInt32 },
+  'int64': { array: null, read: readInt64, wide: true },
+  'uint64': { array: null, read: readUInt64, wide: true },
+  'long': { array: null, read: readInt64, wide: true },
+  'ulong': { array: null, read: readUInt64, wide: true },
+  'float': { array: Float32Array, read: readFloat },
+  'double': { array: Float64Array, read: readDouble },
+  'pointer': { array: null, read: readUInt64, wide: true, pointer: true }
+};
+
+/*
+ * Accepts either { returnType, argumentTypes, abi } or the C-like shorthand
+ * 'int (pointer, int)'.
+ */
+function NativeSignature(spec) {
+  var returnType, argumentTypes, abi;
+  if (typeof spec === 'string') {
+    var match = /^\s*(\w+)\s*\(([^)]*)\)\s*$/.exec(spec);
+    if (match === null)
+      throw new Error('Invalid signature: ' + spec);
+    returnType = match[1];
+    var list = match[2].trim();
+    argumentTypes = (list.length > 0 && list !== 'void')
+        ? list.split(',').map(function (t) { return t.trim(); })
+        : [];
+    abi = 'default';
+  } else {
+    returnType = spec.returnType || 'void';
+    argumentTypes = spec.argumentTypes || [];
+    abi = spec.abi || 'default';
+  }
+
+  [returnType].concat(argumentTypes).forEach(function (type) {
+    if (!TYPES.hasOwnProperty(type))
+      throw new Error('Unsupported type: ' + type);
+  });
+  if (argumentTypes.indexOf('void') !== -1)
+    throw new Error('Invalid signature: void is only valid as return type');
+
+  Object.defineProperty(this, 'returnType', {
+    enumerable: true,
+    value: returnType
+  });
+
+  Object.defineProperty(this, 'argumentTypes', {
+    enumerable: true,
+    value: argumentTypes
+  });
+
+  Object.defineProperty(this, 'abi', {
+    enumerable: true,
+    value: abi
+  });
+}
+
+NativeSignature.SLOT_SIZE = SLOT_SIZE;
+
+NativeSignature.prototype.encodeArguments = function (args) {
+  args = args || [];
+  if (args.length !== this.argumentTypes.length) {
+    throw new Error('Expected ' + this.argumentTypes.length +
+        ' arguments, got ' + args.length);
+  }
+  return args.map(function (value, i) {
+    var type = TYPES[this.argumentTypes[i]];
+    if (!type.wide)
+      return value;
+    if (type.pointer)
+      return '0x' + toBigInt(value).toString(16);
+    return toBigInt(value).toString();
+  }, this);
+};
+
+NativeSignature.prototype.decodeResult = function (data, index) {
+  return TYPES[this.returnType].read(data, index * SLOT_SIZE);
+};
+
+/*
+ * Decodes a block of result slots. When every call shares a return type that
+ * fits a typed array we hand one back; wider results become an Array of
+ * big-integer values.
+ */
+NativeSignature.decodeResults = function (signatures, data) {
+  var first = signatures.length > 0 ? signatures[0].returnType : null;
+  var uniform = signatures.every(function (signature) {
+    return signature.returnType === first;
+  });
+  var ArrayType = (first !== null && uniform) ? TYPES[first].array : null;
+
+  var results = (ArrayType !== null)
+      ? new ArrayType(signatures.length)
+      : new Array(signatures.length);
+  signatures.forEach(function (signature, i) {
+    results[i] = signature.decodeResult(data, i);
+  });
+  return results;
+};
+
+function toBigInt(value) {
+  if (typeof value === 'number' || typeof value === 'string')
+    return bigInt(value);
+  return value;
+}
+
+function readInt8(data, offset) {
+  return data.readInt8(offset);
+}
+
+function readUInt8(data, offset) {
+  return data.readUInt8(offset);
+}
+
+function readInt16(data, offset) {
+  return data.readInt16LE(offset);
+}
+
+function readUInt16(data, offset) {
+  return data.readUInt16LE(offset);
+}
+
+function readInt32(data, offset) {
+  return data.readInt32LE(offset);
+}
+
+function readUInt32(data, offset) {
+  return data.readUInt32LE(offset);
+}
+
+function readInt64(data, offset) {
+  var high = data.readInt32LE(offset + 4);
+  var low = data.readUInt32LE(offset);
+  return bigInt(high).shiftLeft(32).add(low);
+}
+
+function readUInt64(data, offset) {
+  var high = data.readUInt32LE(offset + 4);
+  var low = data.readUInt32LE(offset);
+  return bigInt(high).shiftLeft(32).add(low);
+}
+
+function readFloat(data, offset) {
+  return data.readFloatLE(offset);
+}
+
+function readDouble(data, offset) {
+  return data.readDoubleLE(offset);
+}
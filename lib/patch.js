@@ -0,0 +1,36 @@
+'use strict';
+
+module.exports = Patch;
+
+
+var request = Symbol('request');
+var id = Symbol('id');
+var active = Symbol('active');
+
+function Patch(session, sessionRequest, patchId, pageCount) {
+  Object.defineProperty(this, request, {
+    value: session[sessionRequest].bind(session)
+  });
+
+  Object.defineProperty(this, 'pageCount', {
+    enumerable: true,
+    value: pageCount
+  });
+
+  this[id] = patchId;
+  this[active] = true;
+}
+
+Object.defineProperty(Patch.prototype, 'active', {
+  enumerable: true,
+  get: function () {
+    return this[active];
+  }
+});
+
+Patch.prototype.rollback = function () {
+  if (!this[active])
+    return Promise.reject(new Error('Patch has already been rolled back'));
+  this[active] = false;
+  return this[request]('memory:unpatch', { id: this[id] });
+};
@@ -5,6 +5,8 @@ module.exports = ptr;
 
 var bigInt = require('big-integer');
 
+var MAX_SAFE_HIGH = 0x200000;
+
 function ptr(value) {
   if (typeof value === 'string') {
     if (value.indexOf('0x') === 0) {
@@ -18,3 +20,38 @@ function ptr(value) {
     throw new Error('Invalid pointer value: ' + value);
   }
 }
+
+/*
+ * Reads a little-endian uint64, taking the plain-number path for anything
+ * below 2^53, which covers user-space addresses on current platforms.
+ */
+ptr.fromBuffer = function (buffer, offset) {
+  var low = buffer.readUInt32LE(offset);
+  var high = buffer.readUInt32LE(offset + 4);
+  if (high < MAX_SAFE_HIGH)
+    return bigInt(high * 4294967296 + low);
+  return bigInt(high).shiftLeft(32).add(low);
+};
+
+/*
+ * Writes a pointer as a little-endian uint64, the inverse of fromBuffer().
+ */
+ptr.toBuffer = function (value, buffer, offset) {
+  buffer.writeUInt32LE(value.and(0xffffffff).toJSNumber(), offset);
+  buffer.writeUInt32LE(value.shiftRight(32).toJSNumber(), offset + 4);
+};
+
+/*
+ * Splits a session helper reply into its JSON payload and the column of
+ * addresses packed into its data attachment.
+ */
+ptr.unpackReply = function (reply) {
+  if (!(reply instanceof Array))
+    return { payload: reply, addresses: [] };
+  var data = reply[1];
+  var count = data.length / 8;
+  var addresses = new Array(count);
+  for (var i = 0; i !== count; i++)
+    addresses[i] = ptr.fromBuffer(data, i * 8);
+  return { payload: reply[0], addresses: addresses };
+};
@@ -3,6 +3,8 @@
 module.exports = Range;
 
 
+var ptr = require('./ptr');
+
 function Range(baseAddress, size, protection) {
   Object.defineProperty(this, 'baseAddress', {
     enumerable: true,
@@ -19,3 +21,14 @@ function Range(baseAddress, size, protection) {
     value: protection
   });
 }
+
+Range.fromReply = function (reply) {
+  var result = ptr.unpackReply(reply);
+  return Range.fromColumns(result.payload, result.addresses);
+};
+
+Range.fromColumns = function (columns, bases) {
+  return bases.map(function (base, i) {
+    return new Range(base, columns.sizes[i], columns.protections[i]);
+  });
+};
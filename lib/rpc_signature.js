@@ -0,0 +1,185 @@
+'use strict';
+
+module.exports = RpcSignature;
+
+
+var bigInt = require('big-integer');
+var ptr = require('./ptr');
+
+var SIGNATURE_PATTERN = /^\s*\(([^)]*)\)\s*(?:->\s*(\w+)\s*)?$/;
+
+// Bytes taken in the argument frame; a buffer takes a u32 length prefix
+// plus its contents, and strings travel separately as JSON.
+var TYPE_SIZES = {
+  'void': 0,
+  'bool': 1,
+  'i8': 1,
+  'u8': 1,
+  'i16': 2,
+  'u16': 2,
+  'i32': 4,
+  'u32': 4,
+  'f32': 4,
+  'f64': 8,
+  'i64': 8,
+  'u64': 8,
+  'string': 0,
+  'buffer': 4
+};
+
+var TWO_TO_64 = bigInt(1).shiftLeft(64);
+
+/*
+ * A signature such as '(u64, buffer, string) -> i32', parsed and checked
+ * once so that calls only pay for encoding their arguments.
+ */
+function RpcSignature(spec) {
+  var match = SIGNATURE_PATTERN.exec(spec);
+  if (match === null)
+    throw new TypeError('Invalid RPC signature: ' + spec);
+
+  var argumentTypes = (match[1].trim() !== '')
+      ? match[1].split(',').map(function (type) {
+        return type.trim();
+      })
+      : [];
+  var returnType = match[2] || 'void';
+
+  var fixedSize = 0;
+  argumentTypes.forEach(function (type) {
+    if (!TYPE_SIZES.hasOwnProperty(type) || type === 'void')
+      throw new TypeError('Unsupported argument type: ' + type);
+    fixedSize += TYPE_SIZES[type];
+  });
+  if (!TYPE_SIZES.hasOwnProperty(returnType))
+    throw new TypeError('Unsupported return type: ' + returnType);
+
+  this.argumentTypes = argumentTypes;
+  this.returnType = returnType;
+  this.fixedSize = fixedSize;
+}
+
+RpcSignature.prototype.encodeArguments = function (args) {
+  var types = this.argumentTypes;
+  if (args.length !== types.length)
+    throw new TypeError('Expected ' + types.length + ' argument(s)');
+
+  var size = this.fixedSize;
+  var buffers = [];
+  types.forEach(function (type, i) {
+    if (type === 'buffer') {
+      var value = args[i];
+      if (!Buffer.isBuffer(value))
+        throw new TypeError('Expected a Buffer for argument ' + i);
+      size += value.length;
+    }
+  });
+
+  var frame = new Buffer(size);
+  var strings = [];
+  var offset = 0;
+  types.forEach(function (type, i) {
+    var value = args[i];
+    switch (type) {
+      case 'bool':
+        frame.writeUInt8(value ? 1 : 0, offset);
+        break;
+      case 'i8':
+        frame.writeInt8(value, offset);
+        break;
+      case 'u8':
+        frame.writeUInt8(value, offset);
+        break;
+      case 'i16':
+        frame.writeInt16LE(value, offset);
+        break;
+      case 'u16':
+        frame.writeUInt16LE(value, offset);
+        break;
+      case 'i32':
+        frame.writeInt32LE(value, offset);
+        break;
+      case 'u32':
+        frame.writeUInt32LE(value, offset);
+        break;
+      case 'f32':
+        frame.writeFloatLE(value, offset);
+        break;
+      case 'f64':
+        frame.writeDoubleLE(value, offset);
+        break;
+      case 'i64':
+      case 'u64':
+        write64(frame, offset, value);
+        break;
+      case 'string':
+        strings.push(String(value));
+        break;
+      case 'buffer':
+        frame.writeUInt32LE(value.length, offset);
+        value.copy(frame, offset + 4);
+        offset += value.length;
+        break;
+    }
+    offset += TYPE_SIZES[type];
+  });
+
+  return {
+    frame: frame.toString('base64'),
+    strings: strings
+  };
+};
+
+/*
+ * Results come back as the reply's data attachment, except for strings,
+ * which stay in the JSON payload.
+ */
+RpcSignature.prototype.decodeResult = function (value) {
+  switch (this.returnType) {
+    case 'void':
+      return undefined;
+    case 'string':
+      return value;
+    case 'buffer':
+      return Buffer.isBuffer(value) ? value : new Buffer(0);
+    case 'bool':
+      return value.readUInt8(0) !== 0;
+    case 'i8':
+      return value.readInt8(0);
+    case 'u8':
+      return value.readUInt8(0);
+    case 'i16':
+      return value.readInt16LE(0);
+    case 'u16':
+      return value.readUInt16LE(0);
+    case 'i32':
+      return value.readInt32LE(0);
+    case 'u32':
+      return value.readUInt32LE(0);
+    case 'f32':
+      return value.readFloatLE(0);
+    case 'f64':
+      return value.readDoubleLE(0);
+    case 'u64':
+      return ptr.fromBuffer(value, 0);
+    case 'i64':
+      var result = ptr.fromBuffer(value, 0);
+      return (value.readInt32LE(4) < 0) ? result.subtract(TWO_TO_64) : result;
+  }
+};
+
+function write64(frame, offset, value) {
+  var low, high;
+  if (typeof value === 'number') {
+    high = Math.floor(value / 4294967296);
+    low = value - high * 4294967296;
+  } else {
+    var v = (typeof value === 'string') ? ptr(value) : bigInt(value.toString());
+    if (v.isNegative())
+      v = v.add(TWO_TO_64);
+    low = v.and(0xffffffff).toJSNumber();
+    high = v.shiftRight(32).toJSNumber();
+  }
+  frame.writeUInt32LE(low, offset);
+  frame.writeUInt32LE(high >>> 0, offset + 4);
+}
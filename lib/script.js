@@ -3,43 +3,88 @@
 module.exports = Script;
 
 
+var batching = require('./batching');
+var binding = require('bindings')('frida_binding');
+var cancellable = require('./cancellable');
+var fragmentation = require('./fragmentation');
+var Message = require('./message');
+var RpcSignature = require('./rpc_signature');
+var typedRpc = require('./typed_rpc');
 var $ = Symbol('impl');
 var messageHandlers = Symbol('messageHandlers');
+var errorHandlers = Symbol('errorHandlers');
+var onPostError = Symbol('onPostError');
+var onPostFailed = Symbol('onPostFailed');
+var typedRpcEnabled = Symbol('typedRpcEnabled');
 var nextRequestId = Symbol('nextRequestId');
 var pending = Symbol('pending');
 var rpcRequest = Symbol('rpcRequest');
+var typedRpcRequest = Symbol('typedRpcRequest');
+var expectReply = Symbol('expectReply');
 var onDestroyed = Symbol('onDestroyed');
 var onDestroyedCallback = Symbol('onDestroyedCallback');
 var onMessage = Symbol('onMessage');
 var onMessageCallback = Symbol('onMessageCallback');
 var onRpcMessage = Symbol('onRpcMessage');
+var reassembler = Symbol('reassembler');
+var onReassembled = Symbol('onReassembled');
+var owner = Symbol('owner');
 
-function Script(impl) {
+function Script(impl, options) {
   Object.defineProperty(this, $, { value: impl });
 
   Object.defineProperty(this, 'events', { value: new ScriptEvents(impl, this[onRpcMessage].bind(this)) });
 
+  Object.defineProperty(impl, '_onPostError', {
+    value: this[onPostFailed].bind(this)
+  });
+
   this[pending] = {};
   this[nextRequestId] = 1;
+  this[typedRpcEnabled] = !!(options && options.typedRpc);
 }
 
-Script.prototype.load = function () {
-  return this[$].load();
+Script.prototype.load = function (options) {
+  return cancellable.track(this[$].load(), options);
+};
+
+Script.prototype.unload = function (options) {
+  return cancellable.track(this[$].unload(), options);
 };
 
-Script.prototype.unload = function () {
-  return this[$].unload();
+Script.prototype.postMessage = function (message, options) {
+  return cancellable.track(this[$].postMessage(message), options);
 };
 
-Script.prototype.postMessage = function (message) {
-  return this[$].postMessage(message);
+Script.prototype.post = function (message) {
+  this[$].post(message);
 };
 
+/*
+ * In scripts created with { typedRpc: true }, exports with an entry in the
+ * agent's rpc.signatures get typed stubs whose arguments and results skip
+ * JSON; the rest go through plain rpc calls.
+ */
 Script.prototype.getExports = function () {
-  return this[rpcRequest]('list', [])
-  .then(function (methodNames) {
-    var proxy = methodNames.reduce(function (proxy, methodName) {
-      proxy[methodName] = makeRpcMethod(methodName, this);
+  if (!this[typedRpcEnabled]) {
+    return this[rpcRequest]('list', [])
+    .then(function (methodNames) {
+      var proxy = methodNames.reduce(function (proxy, methodName) {
+        proxy[methodName] = makeRpcMethod(methodName, this);
+        return proxy;
+      }.bind(this), {});
+      return Object.freeze(proxy);
+    }.bind(this));
+  }
+
+  return this[typedRpcRequest]({ op: 'describe' })
+  .then(function (description) {
+    var signatures = description.signatures;
+    var proxy = description.names.reduce(function (proxy, methodName) {
+      var spec = signatures[methodName];
+      proxy[methodName] = (spec !== undefined)
+          ? makeTypedRpcMethod(methodName, new RpcSignature(spec), this)
+          : makeRpcMethod(methodName, this);
       return proxy;
     }.bind(this), {});
     return Object.freeze(proxy);
@@ -52,24 +97,71 @@ function makeRpcMethod(name, script) {
   };
 }
 
+function makeTypedRpcMethod(name, signature, script) {
+  return function () {
+    var encoded;
+    try {
+      encoded = signature.encodeArguments(arguments);
+    } catch (e) {
+      return Promise.reject(e);
+    }
+    return script[typedRpcRequest]({
+      op: 'call',
+      name: name,
+      frame: encoded.frame,
+      strings: encoded.strings
+    })
+    .then(function (result) {
+      return signature.decodeResult(result);
+    });
+  };
+}
+
 Script.prototype[rpcRequest] = function (operation) {
   var params = Array.prototype.slice.call(arguments, 1);
 
   return new Promise(function (resolve, reject) {
-    var id = this[nextRequestId]++;
-    this[pending][id] = function (err, result) {
-      if (!err)
-        resolve(result);
-      else
-        reject(err);
-    };
+    var id = this[expectReply](resolve, reject);
     this.postMessage(['frida:rpc', id, operation].concat(params));
   }.bind(this));
 };
 
+Script.prototype[typedRpcRequest] = function (message) {
+  return new Promise(function (resolve, reject) {
+    message.type = typedRpc.TAG;
+    message.id = this[expectReply](resolve, reject);
+    this[$].post(message, message.id);
+  }.bind(this));
+};
+
+// Posts tagged with a request id fail that request; the rest are reported
+// through the 'error' event.
+Script.prototype[onPostFailed] = function (error, id) {
+  var callback = (id !== undefined) ? this[pending][id] : undefined;
+  if (callback === undefined) {
+    this.events[onPostError](error);
+    return;
+  }
+  delete this[pending][id];
+  callback(error, null);
+};
+
+Script.prototype[expectReply] = function (resolve, reject) {
+  var id = this[nextRequestId]++;
+  this[pending][id] = function (err, result) {
+    if (!err)
+      resolve(result);
+    else
+      reject(err);
+  };
+  return id;
+};
+
 Script.prototype[onRpcMessage] = function (id, operation, params, data) {
   if (operation === 'ok' || operation === 'error') {
     var callback = this[pending][id];
+    if (callback === undefined)
+      return;
     delete this[pending][id];
 
     var value = null;
@@ -87,52 +179,176 @@ function ScriptEvents(impl, onRpcMessageCallback) {
   Object.defineProperty(this, $, { value: impl });
 
   this[messageHandlers] = [];
+  this[errorHandlers] = [];
+  this[reassembler] = new fragmentation.Reassembler();
 
   this[onDestroyedCallback] = this[onDestroyed].bind(this);
   this[onMessageCallback] = this[onMessage].bind(this);
-  impl.events.listen('destroyed', this[onDestroyedCallback]);
-  impl.events.listen('message', this[onMessageCallback]);
+  // Held weakly so that a Script nobody references can be collected; any
+  // strong message listener keeps this object alive through its proxy.
+  impl.events.listen('destroyed', this[onDestroyedCallback], { weak: true });
+  impl.events.listen('message', this[onMessageCallback], {
+    raw: true,
+    weak: true
+  });
 
   this[onRpcMessage] = onRpcMessageCallback;
 }
 
 ScriptEvents.prototype[onDestroyed] = function () {
   var impl = this[$];
+  this[reassembler].clear();
   impl.events.unlisten('message', this[onMessageCallback]);
   impl.events.unlisten('destroyed', this[onDestroyedCallback]);
 };
 
-ScriptEvents.prototype[onMessage] = function (message, data) {
-  if (isRpcMessage(message)) {
-    var rpcMessage = message.payload;
+ScriptEvents.prototype[onMessage] = function (json, data) {
+  var type = Message.peekType(json) || JSON.parse(json).type;
+  if (type === 'send' && Message.isFragment(json)) {
+    var message = this[reassembler].add(JSON.parse(json).payload, data);
+    if (message !== null)
+      this[onReassembled](message[0], message[1]);
+  } else if (type === 'send' && Message.isBatch(json)) {
+    batching.unpack(JSON.parse(json).payload, data).forEach(function (entry) {
+      var payload = entry[0];
+      if (isRpcMessage({ type: 'send', payload: payload }))
+        this[onRpcMessage](payload[1], payload[2], payload.slice(3), entry[1]);
+    }, this);
+  } else if (type === 'send' && Message.isRpc(json)) {
+    var rpcMessage = JSON.parse(json).payload;
     var id = rpcMessage[1];
     var operation = rpcMessage[2];
     var params = rpcMessage.slice(3);
     this[onRpcMessage](id, operation, params, data);
-  } else if (isLogMessage(message)) {
-    console.log(message.payload);
+  } else if (type === 'log') {
+    console.log(JSON.parse(json).payload);
+  }
+};
+
+// Fragments are reassembled once here, rather than by every listener, and
+// the result is then handed to each of them.
+ScriptEvents.prototype[onReassembled] = function (payload, data) {
+  var entries = batching.isBatch(payload)
+      ? batching.unpack(payload, data)
+      : [[payload, data]];
+  entries.forEach(function (entry) {
+    var message = { type: 'send', payload: entry[0] };
+    if (isRpcMessage(message)) {
+      this[onRpcMessage](entry[0][1], entry[0][2], entry[0].slice(3), entry[1]);
+      return;
+    }
+    this[messageHandlers].slice().forEach(function (handler) {
+      handler.deliver(message, entry[1]);
+    });
+  }, this);
+};
+
+ScriptEvents.prototype[onPostError] = function (error) {
+  var handlers = this[errorHandlers];
+  if (handlers.length === 0) {
+    console.error('Script.post() failed: ' + error.message);
+    return;
   }
+  handlers.slice().forEach(function (callback) {
+    callback(error);
+  });
 };
 
-ScriptEvents.prototype.listen = function (signal, callback) {
+ScriptEvents.prototype.listen = function (signal, callback, options) {
+  if (signal === 'error') {
+    this[errorHandlers].push(callback);
+    return;
+  }
   if (signal !== 'message') {
-    this[$].events.listen(signal, callback);
+    this[$].events.listen(signal, callback, options);
     return;
   }
 
+  // A weak message listener is tied to this Script rather than to the
+  // callback, which stays referenced from here for as long as the Script
+  // is: the listener neither keeps the Script alive, nor is it dropped
+  // while the Script is still reachable. Once the Script is collected its
+  // handler is disconnected. Non-weak listeners keep the Script alive.
+  options = options || {};
+  var filter = options.filter || null;
+  var lazy = !!options.lazy;
+  var weak = !!options.weak;
+
+  // Filtered listeners get batches split natively. Messages reassembled
+  // from fragments never come through the native path at all, so they are
+  // checked against the same filter, compiled once, here.
+  var compiled = (filter !== null)
+      ? new binding.MessageFilter(JSON.stringify(filter))
+      : null;
+  var deliver = function (message, data) {
+    if (isRpcMessage(message))
+      return;
+    if (compiled !== null && !compiled.matches(message, data.length > 0))
+      return;
+    callback(lazy ? new Message(JSON.stringify(message)) : message, data);
+  };
+  var deliverBatch = function (payload, data) {
+    batching.unpack(payload, data).forEach(function (entry) {
+      deliver({ type: 'send', payload: entry[0] }, entry[1]);
+    });
+  };
+
   var handler = {
     callback: callback,
-    proxy: function (message, data) {
-      var isInternalMessage = isRpcMessage(message) || isLogMessage(message);
+    proxy: null,
+    deliver: deliver
+  };
+
+  if (filter !== null) {
+    handler.proxy = lazy ?
+      function (json, data) {
+        callback(new Message(json), data);
+      } :
+      function (message, data) {
+        callback(message, data);
+      };
+    filter = { all: [filter, { not: INTERNAL_MESSAGE_FILTER }] };
+  } else if (lazy) {
+    handler.proxy = function (json, data) {
+      if (Message.isBatch(json)) {
+        deliverBatch(JSON.parse(json).payload, data);
+        return;
+      }
+      var message = new Message(json);
+      var isInternalMessage = Message.isRpc(json) ||
+          Message.isFragment(json) || message.type === 'log';
       if (!isInternalMessage)
         callback(message, data);
-    }
-  };
+    };
+  } else {
+    handler.proxy = function (message, data) {
+      if (isBatchMessage(message)) {
+        deliverBatch(message.payload, data);
+        return;
+      }
+      var isInternalMessage = isRpcMessage(message) ||
+          isFragmentMessage(message) || isLogMessage(message);
+      if (!isInternalMessage)
+        callback(message, data);
+    };
+  }
+  if (!weak)
+    Object.defineProperty(handler.proxy, owner, { value: this });
+  this[$].events.listen(signal, handler.proxy, {
+    filter: filter,
+    raw: lazy,
+    weak: weak
+  });
   this[messageHandlers].push(handler);
-  this[$].events.listen(signal, handler.proxy);
 };
 
 ScriptEvents.prototype.unlisten = function (signal, callback) {
+  if (signal === 'error') {
+    var index = this[errorHandlers].indexOf(callback);
+    if (index !== -1)
+      this[errorHandlers].splice(index, 1);
+    return;
+  }
   if (signal !== 'message') {
     this[$].events.unlisten(signal, callback);
     return;
@@ -149,6 +365,22 @@ ScriptEvents.prototype.unlisten = function (signal, callback) {
   }
 };
 
+var INTERNAL_MESSAGE_FILTER = {
+  any: [
+    { type: 'send', payload: { '0': 'frida:rpc' } },
+    { type: 'send', payload: { '0': 'frida:fragment' } },
+    { type: 'log' }
+  ]
+};
+
+function isBatchMessage(message) {
+  return message.type === 'send' && batching.isBatch(message.payload);
+}
+
+function isFragmentMessage(message) {
+  return message.type === 'send' && fragmentation.isFragment(message.payload);
+}
+
 function isLogMessage(message) {
   return message.type === 'log';
 }
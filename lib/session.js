@@ -3,26 +3,53 @@
 module.exports = Session;
 
 
+var agentShim = require('./agent_shim');
+var Arena = require('./arena');
+var batching = require('./batching');
+var binding = require('bindings')('frida_binding');
+var cancellable = require('./cancellable');
+var fragmentation = require('./fragmentation');
 var fs = require('fs');
 var FunctionContainer = require('./function_container');
+var LatencyProfiler = require('./latency_profiler');
+var LockProfiler = require('./lock_profiler');
 var Module = require('./module');
+var ModuleInfo = require('./module_info');
 var ModuleMap = require('./module_map');
+var NativeSignature = require('./native_signature');
+var Patch = require('./patch');
 var path = require('path');
 var ProcessFunction = require('./process_function');
 var ptr = require('./ptr');
 var Range = require('./range');
 var Script = require('./script');
+var SnapshotStore = require('./snapshot_store');
+var stackCapture = require('./stack_capture');
+var StringStream = require('./string_stream');
+var typedRpc = require('./typed_rpc');
+var UploadStream = require('./upload_stream');
 var $ = Symbol('impl');
 var pending = Symbol('pending');
 var nextRequestId = Symbol('nextRequestId');
 var modulesPromise = Symbol('modulesPromise');
 var request = Symbol('request');
+var subscribe = Symbol('subscribe');
+var subscriptions = Symbol('subscriptions');
 var onMessage = Symbol('onMessage');
 var getSessionScript = Symbol('getSessionScript');
 var scriptPromise = Symbol('scriptPromise');
 var moduleMap = Symbol('moduleMap');
+var createModules = Symbol('createModules');
+var moduleRegistry = Symbol('moduleRegistry');
+var moduleInfos = Symbol('moduleInfos');
 
-function Session(impl) {
+var DEFAULT_HOT_MODULE_COUNT = 4;
+var DEFAULT_MAX_FRAMES = 64;
+var DEFAULT_SCAN_CHUNK_SIZE = 16 * 1024 * 1024;
+var SNAPSHOT_HASH_CHUNK_SIZE = 4 * 1024 * 1024;
+var SNAPSHOT_PAGES_PER_READ = 256;
+
+function Session(impl, registry) {
   FunctionContainer.call(this);
 
   Object.defineProperty(this, $, { value: impl });
@@ -32,8 +59,19 @@ function Session(impl) {
         Object.getOwnPropertyDescriptor(impl, prop));
   }, this);
 
+  // Module metadata is held until the session is detached. The listener
+  // only captures what it releases, so it does not keep the Session alive.
+  registry = registry || new ModuleInfo.Registry();
+  var infos = [];
+  this[moduleRegistry] = registry;
+  this[moduleInfos] = infos;
+  impl.events.listen('detached', function () {
+    infos.splice(0, infos.length).forEach(registry.release, registry);
+  });
+
   this[pending] = {};
   this[nextRequestId] = 1;
+  this[subscriptions] = {};
 
   this[modulesPromise] = null;
 
@@ -44,18 +82,89 @@ function Session(impl) {
 
 Session.prototype = Object.create(FunctionContainer.prototype);
 
-Session.prototype.detach = function () {
-  return this[$].detach();
+Session.prototype.detach = function (options) {
+  return cancellable.track(this[$].detach(), options);
+};
+
+/*
+ * Loads the helper script, the module list and the exports of hot modules
+ * into the caches ahead of use. Each step waits for the event loop to go
+ * idle first, and the rest are abandoned once the session is detached.
+ * `policy.exports` names the hot modules, or gives how many of the first
+ * modules in load order to take.
+ */
+Session.prototype.warmUp = function (policy) {
+  policy = (typeof policy === 'object' && policy !== null) ? policy : {};
+  var hot = (policy.exports !== undefined)
+      ? policy.exports
+      : DEFAULT_HOT_MODULE_COUNT;
+
+  var events = this[$].events;
+  var detached = false;
+  var abort = null;
+  var onDetached = function () {
+    detached = true;
+    if (abort !== null)
+      abort(new Error('Session detached'));
+  };
+  events.listen('detached', onDetached);
+
+  // Each step waits until both the frida thread and our event loop have
+  // nothing better to do. A step still in flight when the session goes away
+  // would never get its reply, so detaching also rejects it. A step that
+  // fails because of the detach may beat the 'detached' event here, so its
+  // error is only reported once things have settled.
+  var whenIdle = function (work) {
+    return new Promise(function (resolve, reject) {
+      abort = reject;
+      binding.whenIdle(function () {
+        if (detached) {
+          reject(new Error('Session detached'));
+          return;
+        }
+        work().then(resolve, function (error) {
+          binding.whenIdle(function () {
+            reject(detached ? new Error('Session detached') : error);
+          });
+        });
+      });
+    });
+  };
+
+  var finish = function () {
+    abort = null;
+    events.unlisten('detached', onDetached);
+  };
+
+  return whenIdle(this[getSessionScript].bind(this))
+  .then(function () {
+    return whenIdle(this.enumerateModules.bind(this));
+  }.bind(this))
+  .then(function (modules) {
+    var hotModules = (hot instanceof Array)
+        ? modules.filter(function (m) {
+          return hot.indexOf(m.name) !== -1;
+        })
+        : modules.slice(0, hot);
+    return hotModules.reduce(function (previous, m) {
+      return previous.then(function () {
+        return whenIdle(m.enumerateExports.bind(m));
+      });
+    }, Promise.resolve());
+  })
+  .then(finish, function (error) {
+    finish();
+    throw error;
+  });
 };
 
 Session.prototype.enumerateModules = function () {
   if (this[modulesPromise] === null) {
     this[modulesPromise] = new Promise(function (resolve, reject) {
       this[request]('process:enumerate-modules')
-      .then(function (result) {
-        resolve(result.modules.map(function (m) {
-          return new Module(m.name, ptr(m.base), m.size, m.path, this, request);
-        }, this));
+      .then(function (reply) {
+        var result = ptr.unpackReply(reply);
+        resolve(this[createModules](result.payload, result.addresses));
       }.bind(this))
       .catch(reject);
     }.bind(this));
@@ -63,6 +172,233 @@ Session.prototype.enumerateModules = function () {
   return this[modulesPromise];
 };
 
+Session.prototype[createModules] = function (columns, bases) {
+  return bases.map(function (base, i) {
+    var info = this[moduleRegistry].acquire(columns.names[i],
+        columns.paths[i], columns.sizes[i], columns.buildIds[i]);
+    this[moduleInfos].push(info);
+    return new Module(info, base, this, request);
+  }, this);
+};
+
+/*
+ * Takes modules, ranges with the given protection, and threads in a single
+ * round trip. The module list also seeds the enumerateModules() cache.
+ */
+Session.prototype.census = function (options) {
+  options = options || {};
+  var wantModules = options.modules !== false;
+  var protection = (options.ranges === undefined || options.ranges === true)
+      ? 'r--'
+      : options.ranges;
+  var wantThreads = options.threads !== false;
+
+  return this[request]('process:census', {
+    modules: wantModules,
+    ranges: protection,
+    threads: wantThreads
+  })
+  .then(function (reply) {
+    var result = ptr.unpackReply(reply);
+    var columns = result.payload;
+    var addresses = result.addresses;
+    var offset = 0;
+    var census = {};
+
+    if (wantModules) {
+      var count = columns.modules.names.length;
+      census.modules = this[createModules](columns.modules,
+          addresses.slice(offset, offset + count));
+      offset += count;
+      if (this[modulesPromise] === null)
+        this[modulesPromise] = Promise.resolve(census.modules);
+    }
+
+    if (protection) {
+      var rangeCount = columns.ranges.sizes.length;
+      census.ranges = Range.fromColumns(columns.ranges,
+          addresses.slice(offset, offset + rangeCount));
+      offset += rangeCount;
+    }
+
+    if (wantThreads) {
+      var threads = columns.threads;
+      census.threads = threads.ids.map(function (id, i) {
+        return {
+          id: id,
+          state: threads.states[i],
+          pc: addresses[offset + 2 * i],
+          sp: addresses[offset + 2 * i + 1]
+        };
+      });
+    }
+
+    return census;
+  }.bind(this));
+};
+
+/*
+ * Turns a captureStack() blob into return addresses, innermost first. The
+ * walk runs on the threadpool against .eh_frame read from the module
+ * files on disk, falling back to the rbp chain where there is no CFI or
+ * the file's build-id does not match the loaded one, so the agent only
+ * pays for one memory copy per sample. Only built for x86-64 Linux.
+ */
+Session.prototype.unwind = function (stack, options) {
+  if (binding.unwindStack === undefined)
+    return Promise.reject(new Error('Stack unwinding is only supported on ' +
+        'x86-64 Linux'));
+
+  options = options || {};
+  var maxFrames = options.maxFrames || DEFAULT_MAX_FRAMES;
+  return this.enumerateModules()
+  .then(function (modules) {
+    return binding.unwindStack(stack, modules.map(function (m) {
+      return [m.path, '0x' + m.baseAddress.toString(16), m.size, m.buildId];
+    }), maxFrames);
+  })
+  .then(function (frames) {
+    var count = frames.length / 8;
+    var result = new Array(count);
+    for (var i = 0; i !== count; i++)
+      result[i] = ptr.fromBuffer(frames, i * 8);
+    return result;
+  });
+};
+
+/*
+ * Summarizes the glibc malloc heaps of a 64-bit Linux target, yielding
+ * totals plus a per-size-class histogram in columns. The agent only
+ * describes the arenas, heap segments and free lists; the segments are
+ * then read in chunks of `options.chunkSize` bytes, each walked on the
+ * threadpool while the next one is read, so at most two chunks are held
+ * at a time. The heap keeps changing while it is read, so segments cut
+ * short by that, or by a chunk that can't be read, count in `truncated`.
+ * Allocations above the mmap() threshold live outside of any heap segment
+ * and are not included.
+ */
+Session.prototype.inspectHeap = function (options) {
+  options = options || {};
+  var chunkSize = options.chunkSize || DEFAULT_SCAN_CHUNK_SIZE;
+  chunkSize -= chunkSize % 16;
+
+  return this[request]('process:heap-snapshot')
+  .then(function (reply) {
+    var walker = new binding.HeapWalker(reply[1]);
+
+    var chunks = [];
+    reply[0].segments.forEach(function (segment, index) {
+      var base = ptr(segment[0]);
+      for (var offset = 0; offset < segment[1]; offset += chunkSize) {
+        chunks.push({
+          segment: index,
+          address: base.add(offset),
+          size: Math.min(chunkSize, segment[1] - offset)
+        });
+      }
+    });
+
+    var read = function (i) {
+      if (i === chunks.length)
+        return null;
+      return this.readBytes(chunks[i].address, chunks[i].size)
+      .catch(function () {
+        return null;
+      });
+    }.bind(this);
+
+    var unreadable = {};
+    var walk = function (i, pending) {
+      if (pending === null)
+        return walker.finish();
+      return pending.then(function (data) {
+        var next = read(i + 1);
+        var segment = chunks[i].segment;
+        if (data === null)
+          unreadable[segment] = true;
+        if (unreadable[segment] === true)
+          return walk(i + 1, next);
+        return walker.feed(segment, data).then(function () {
+          return walk(i + 1, next);
+        });
+      });
+    };
+
+    return walk(0, read(0));
+  }.bind(this));
+};
+
+/*
+ * Finds aligned words in the target that point into any of `targets`,
+ * each an address or an { address, size } interval. Ranges, by default
+ * every 'rw-' one, are read in chunks of `options.chunkSize` bytes, the
+ * next read overlapping the scan of the current chunk on the threadpool,
+ * so at most two chunks are held at a time. Unreadable chunks are skipped.
+ */
+Session.prototype.findReferences = function (targets, options) {
+  options = options || {};
+  var chunkSize = options.chunkSize || DEFAULT_SCAN_CHUNK_SIZE;
+  chunkSize -= chunkSize % 8;
+
+  var intervals = new Buffer(targets.length * 16);
+  targets.forEach(function (target, i) {
+    var address = (target.address !== undefined) ? target.address : target;
+    var size = (target.size !== undefined) ? target.size : 1;
+    address = (typeof address === 'object') ? address : ptr(address);
+    ptr.toBuffer(address, intervals, i * 16);
+    ptr.toBuffer(address.add(size), intervals, i * 16 + 8);
+  });
+
+  var ranges = (options.ranges instanceof Array)
+      ? Promise.resolve(options.ranges)
+      : this.enumerateRanges(options.ranges || 'rw-');
+
+  return ranges.then(function (ranges) {
+    var chunks = [];
+    ranges.forEach(function (range) {
+      for (var offset = 0; offset < range.size; offset += chunkSize) {
+        chunks.push({
+          address: range.baseAddress.add(offset),
+          size: Math.min(chunkSize, range.size - offset)
+        });
+      }
+    });
+
+    var references = [];
+    var read = function (i) {
+      if (i === chunks.length)
+        return null;
+      return this.readBytes(chunks[i].address, chunks[i].size)
+      .catch(function () {
+        return null;
+      });
+    }.bind(this);
+
+    var scan = function (i, pending) {
+      if (pending === null)
+        return references;
+      return pending.then(function (data) {
+        var next = read(i + 1);
+        if (data === null)
+          return scan(i + 1, next);
+        return binding.findReferences(data,
+            '0x' + chunks[i].address.toString(16), intervals)
+        .then(function (matches) {
+          for (var offset = 0; offset !== matches.length; offset += 16) {
+            references.push({
+              address: ptr.fromBuffer(matches, offset),
+              target: ptr.fromBuffer(matches, offset + 8)
+            });
+          }
+          return scan(i + 1, next);
+        });
+      });
+    };
+
+    return scan(0, read(0));
+  }.bind(this));
+};
+
 Session.prototype.enumerateRanges = function (protection, options) {
   options = options || {};
   var scope = options.scope || null;
@@ -73,17 +409,13 @@ Session.prototype.enumerateRanges = function (protection, options) {
     data.modulePath = scope;
   }
   return this[request](name, data)
-  .then(function (result) {
-    return result.ranges.map(function (r) {
-      return new Range(ptr(r.base), r.size, r.protection);
-    });
-  });
+  .then(Range.fromReply);
 };
 
 Session.prototype.findBaseAddress = function (moduleName) {
   return this[request]('module:find-base-address', { moduleName: moduleName })
-  .then(function (result) {
-    return ptr(result.baseAddress);
+  .then(function (reply) {
+    return ptr.unpackReply(reply).addresses[0];
   });
 };
 
@@ -126,30 +458,299 @@ Session.prototype.enumerateExports = function (moduleName) {
   return this[request]('module:enumerate-exports', {
     modulePath: moduleName
   })
+  .then(function (reply) {
+    var result = ptr.unpackReply(reply);
+    var columns = result.payload;
+    return result.addresses.map(function (address, i) {
+      return {
+        type: columns.types[i],
+        name: columns.names[i],
+        address: address
+      };
+    });
+  });
+};
+
+Session.prototype.profileLatency = function (targets, options) {
+  options = options || {};
+  var interval = options.interval || 1000;
+  return this[request]('profile:latency-start', {
+    targets: targets.map(function (target) {
+      return '0x' + ptr(target.toString()).toString(16);
+    }),
+    interval: interval
+  })
   .then(function (result) {
-    return result.exports.map(function (e) {
-      e.address = ptr(e.address);
-      return e;
+    return new LatencyProfiler(this, request, subscribe, result.id,
+        result.topic, targets, options);
+  }.bind(this));
+};
+
+Session.prototype.profileLocks = function (options) {
+  options = options || {};
+  return this[request]('profile:locks-start', {
+    interval: options.interval || 1000,
+    contentionThreshold: options.contentionThreshold || 1000
+  })
+  .then(function (result) {
+    return new LockProfiler(this, request, subscribe, result.id, result.topic);
+  }.bind(this));
+};
+
+Session.prototype.patch = function (patches, options) {
+  options = options || {};
+
+  var sorted = patches.map(function (p) {
+    var bytes = Buffer.isBuffer(p.bytes) ? p.bytes : new Buffer(p.bytes);
+    return { address: ptr(p.address.toString()), bytes: bytes };
+  });
+  sorted.sort(function (a, b) {
+    return a.address.compare(b.address);
+  });
+
+  var offset = 0;
+  var entries = sorted.map(function (p) {
+    var entry = ['0x' + p.address.toString(16), offset, p.bytes.length];
+    offset += p.bytes.length;
+    return entry;
+  });
+  var data = Buffer.concat(sorted.map(function (p) {
+    return p.bytes;
+  }), offset);
+
+  return this[request]('memory:patch', {
+    data: data.toString('base64'),
+    patches: entries,
+    suspendThreads: !!options.suspendThreads
+  })
+  .then(function (result) {
+    return new Patch(this, request, result.id, result.pages);
+  }.bind(this));
+};
+
+Session.prototype.createArena = function (options) {
+  options = options || {};
+  var arena = new Arena(this, request, options);
+  return arena.reserve(options.size).then(function () {
+    return arena;
+  });
+};
+
+Session.prototype.createUploadStream = function (address, options) {
+  return new UploadStream(this, request, address, options);
+};
+
+/*
+ * Streams printable strings found in `ranges`, either a list of ranges or
+ * a protection to enumerate them by. See StringStream for the options.
+ */
+Session.prototype.extractStrings = function (ranges, options) {
+  var list = (ranges instanceof Array)
+      ? Promise.resolve(ranges)
+      : this.enumerateRanges(ranges || 'r--');
+  return new StringStream(this, request, list, options);
+};
+
+/*
+ * Captures `options.ranges` ('r--' by default) into `store`, a
+ * SnapshotStore or a directory. The agent hashes every page; only pages
+ * the store lacks are transferred, so pages shared with earlier snapshots,
+ * even of other processes, cost one digest each. A page may change between
+ * being hashed and being transferred, so transferred pages are hashed again
+ * here and stored and listed under what was actually read. Unreadable
+ * ranges are left out of the manifest; any other failure, such as the
+ * store running out of space, rejects.
+ */
+Session.prototype.snapshot = function (store, options) {
+  options = options || {};
+  store = (store instanceof SnapshotStore) ? store : new SnapshotStore(store);
+  var name = options.name || (this.pid + '-' + Date.now());
+  var manifest = { pid: this.pid, pageSize: 0, ranges: [] };
+  var stats = { name: name, pages: 0, transferred: 0 };
+
+  // Resolves to the digests of the pages of [address, address + size), or
+  // to null if they could not be read.
+  var captureChunk = function (address, size) {
+    return this[request]('snapshot:hash-pages', {
+      address: address.toString(),
+      size: size
+    })
+    .then(function (reply) {
+      if (!(reply instanceof Array))
+        return null;
+      manifest.pageSize = reply[0].pageSize;
+      var digests = [];
+      for (var offset = 0; offset !== reply[1].length; offset += 32)
+        digests.push(reply[1].toString('hex', offset, offset + 32));
+      stats.pages += digests.length;
+      return fillMissing(address, digests);
     });
+  }.bind(this);
+
+  // Transfers one page for each digest the store lacks. Each round leaves
+  // fewer pages with unstored digests, so this ends once the pages that
+  // changed under us have been fetched on their own.
+  var fillMissing = function (address, digests) {
+    return store.missing(digests).then(function (missing) {
+      if (missing.length === 0)
+        return digests;
+      var wanted = {};
+      missing.forEach(function (digest) {
+        wanted[digest] = true;
+      });
+      var indices = [];
+      digests.forEach(function (digest, i) {
+        if (wanted[digest]) {
+          indices.push(i);
+          wanted[digest] = false;
+        }
+      });
+      return transferPages(address, digests, indices, 0)
+      .then(function (transferred) {
+        return transferred ? fillMissing(address, digests) : null;
+      });
+    });
+  };
+
+  var transferPages = function (address, digests, indices, start) {
+    if (start >= indices.length)
+      return Promise.resolve(true);
+    var pageSize = manifest.pageSize;
+    var end = Math.min(start + SNAPSHOT_PAGES_PER_READ, indices.length);
+    var batch = indices.slice(start, end);
+    return this[request]('snapshot:read-pages', {
+      addresses: batch.map(function (index) {
+        return address.add(index * pageSize).toString();
+      })
+    })
+    .then(function (reply) {
+      if (!(reply instanceof Array))
+        return false;
+      var data = reply[1];
+      stats.transferred += batch.length;
+      return Promise.all(batch.map(function (index, i) {
+        var page = data.slice(i * pageSize, (i + 1) * pageSize);
+        var digest = SnapshotStore.digest(page);
+        digests[index] = digest;
+        return store.writeObject(digest, page);
+      }))
+      .then(function () {
+        return transferPages(address, digests, indices, end);
+      });
+    });
+  }.bind(this);
+
+  var captureRange = function (range) {
+    var pages = [];
+    var next = function (offset) {
+      if (offset >= range.size)
+        return Promise.resolve(pages);
+      var size = Math.min(SNAPSHOT_HASH_CHUNK_SIZE, range.size - offset);
+      return captureChunk(range.baseAddress.add(offset), size)
+      .then(function (digests) {
+        if (digests === null)
+          return null;
+        pages = pages.concat(digests);
+        return next(offset + size);
+      });
+    };
+    return next(0).then(function (pages) {
+      if (pages === null)
+        return;
+      manifest.ranges.push({
+        base: '0x' + range.baseAddress.toString(16),
+        size: range.size,
+        protection: range.protection,
+        pages: pages
+      });
+    });
+  };
+
+  return this.enumerateRanges(options.ranges || 'r--')
+  .then(function (ranges) {
+    return ranges.reduce(function (previous, range) {
+      return previous.then(function () {
+        return captureRange(range);
+      });
+    }, Promise.resolve());
+  })
+  .then(function () {
+    return store.writeManifest(name, manifest);
+  })
+  .then(function () {
+    return stats;
+  });
+};
+
+Session.prototype.call = function (address, signature, args) {
+  return this.callMany([{
+    address: address,
+    signature: signature,
+    args: args
+  }])
+  .then(function (results) {
+    return results[0];
+  });
+};
+
+Session.prototype.callMany = function (calls) {
+  var signatures;
+  var encoded;
+  try {
+    signatures = calls.map(function (call) {
+      return (call.signature instanceof NativeSignature)
+          ? call.signature
+          : new NativeSignature(call.signature);
+    });
+    encoded = calls.map(function (call, i) {
+      var signature = signatures[i];
+      return {
+        address: '0x' + ptr(call.address.toString()).toString(16),
+        returnType: signature.returnType,
+        argumentTypes: signature.argumentTypes,
+        abi: signature.abi,
+        args: signature.encodeArguments(call.args)
+      };
+    });
+  } catch (e) {
+    return Promise.reject(e);
+  }
+
+  if (calls.length === 0)
+    return Promise.resolve([]);
+
+  return this[request]('function:call', { calls: encoded })
+  .then(function (result) {
+    return NativeSignature.decodeResults(signatures, result[1]);
   });
 };
 
 Session.prototype.createScript = function (source, options) {
   options = options || {};
   var name = options.name || null;
-  return this[$].createScript(name, source).then(function (impl) {
-    return new Script(impl);
-  });
+  if (options.stacks)
+    source = stackCapture.install(source, options.stacks);
+  if (options.batch)
+    source = batching.install(source, options.batch);
+  if (options.fragmentSize > 0)
+    source = fragmentation.install(source, options.fragmentSize);
+  if (options.typedRpc)
+    source = typedRpc.install(source);
+  return cancellable.compose(options, function (step) {
+    return step(this[$].createScript(name, source)).then(function (impl) {
+      return new Script(impl, { typedRpc: !!options.typedRpc });
+    });
+  }.bind(this));
 };
 
 Session.prototype.enableDebugger = function (options) {
   options = options || {};
   var port = options.port || 0;
-  return this[$].enableDebugger(port);
+  return cancellable.track(this[$].enableDebugger(port), options);
 };
 
-Session.prototype.disableDebugger = function () {
-  return this[$].disableDebugger();
+Session.prototype.disableDebugger = function (options) {
+  return cancellable.track(this[$].disableDebugger(), options);
 };
 
 Session.prototype[request] = function (name, payload) {
@@ -178,10 +779,23 @@ Session.prototype[request] = function (name, payload) {
   }.bind(this));
 };
 
+Session.prototype[subscribe] = function (topic, handler) {
+  this[subscriptions][topic] = handler;
+  return function () {
+    delete this[subscriptions][topic];
+  }.bind(this);
+};
+
 Session.prototype[onMessage] = function (message, data) {
   switch (message.type) {
     case 'send':
       var stanza = message.payload;
+      if (stanza.name === 'notification') {
+        var handler = this[subscriptions][stanza.topic];
+        if (handler !== undefined)
+          handler(stanza.payload, data);
+        break;
+      }
       var callback = this[pending][stanza.id];
       delete this[pending][stanza.id];
       switch (stanza.name) {
@@ -212,7 +826,7 @@ Session.prototype[getSessionScript] = function () {
           return;
         }
 
-        this.createScript(source)
+        this.createScript(agentShim.append(source, [agentShim.decodeBase64]))
         .then(function (script) {
           script.events.listen('message', this[onMessage].bind(this));
           return script.load().then(function () {
@@ -1,41 +1,190 @@
 'use strict';
 
-/* global Process, Module, Memory, ptr, send, recv */
+/* global Process, Module, Memory, NativeFunction, Interceptor, ptr, int64, uint64,
+   send, recv, decodeBase64 */
 
 var handlers = {};
 
+/*
+ * Replies carry addresses as a column of little-endian uint64s in the data
+ * attachment, in the same order as the other columns in the JSON payload.
+ */
 handlers['process:enumerate-modules'] = function () {
   return new Promise(function (resolve, reject) {
-    var modules = [];
-    Process.enumerateModules({
-      onMatch: function (m) {
-        modules.push(m);
-      },
-      onComplete: function () {
-        resolve({ modules: modules });
-      }
-    });
+    var modules = collectModules();
+    resolve([modules.columns, packAddresses(modules.bases)]);
   });
 };
 
 handlers['process:enumerate-ranges'] = function (payload) {
   return new Promise(function (resolve, reject) {
-    var ranges = [];
+    var ranges = createRangeColumns();
     Process.enumerateRanges(payload.protection, {
-      onMatch: function (r) {
-        ranges.push(r);
-      },
+      onMatch: ranges.add,
       onComplete: function () {
-        resolve({ ranges: ranges });
+        resolve(ranges.finish());
       }
     });
   });
 };
 
+/*
+ * Modules, ranges and threads in one reply. The address column holds the
+ * module bases, then the range bases, then a pc and sp pair per thread.
+ */
+handlers['process:census'] = function (payload) {
+  return new Promise(function (resolve, reject) {
+    var result = {};
+    var addresses = [];
+
+    if (payload.modules) {
+      var modules = collectModules();
+      result.modules = modules.columns;
+      addresses = addresses.concat(modules.bases);
+    }
+
+    if (payload.ranges) {
+      var ranges = createRangeColumns();
+      Process.enumerateRangesSync(payload.ranges).forEach(ranges.add);
+      result.ranges = ranges.columns;
+      addresses = addresses.concat(ranges.bases);
+    }
+
+    if (payload.threads) {
+      var ids = [];
+      var states = [];
+      Process.enumerateThreadsSync().forEach(function (t) {
+        ids.push(t.id);
+        states.push(t.state);
+        addresses.push(t.context.pc, t.context.sp);
+      });
+      result.threads = { ids: ids, states: states };
+    }
+
+    resolve([result, packAddresses(addresses)]);
+  });
+};
+
+/*
+ * Describes the glibc malloc heaps for the host to walk: a header, then one
+ * table entry per arena (its top chunk), per heap segment and per chunk
+ * found on a fastbin or tcache list. The segments themselves are listed in
+ * the payload and read by the host in bounded chunks, so the agent never
+ * holds a copy of the heap. Arenas that don't look like malloc_state fail
+ * the request.
+ */
+handlers['process:heap-snapshot'] = function () {
+  return new Promise(function (resolve, reject) {
+    if (Process.platform !== 'linux' || Process.pointerSize !== 8)
+      throw new Error('Heap inspection requires glibc on 64-bit Linux');
+
+    var main = findMainArena();
+    var arenas = [main.topSlot];
+    var segments = [{
+      start: main.heapStart,
+      size: toNumber(main.heapEnd.sub(main.heapStart)),
+      arena: 0,
+      flags: HEAP_SEGMENT_INITIAL
+    }];
+
+    var arena = Memory.readPointer(main.topSlot.add(ARENA_NEXT_OFFSET));
+    while (!arena.equals(main.base) && arenas.length !== MAX_ARENAS) {
+      var topSlot = arena.add(main.topOffset);
+      var index = arenas.length;
+      arenas.push(topSlot);
+      collectArenaHeaps(arena, topSlot, main.topOffset, index, segments);
+      arena = Memory.readPointer(topSlot.add(ARENA_NEXT_OFFSET));
+    }
+
+    var tops = arenas.map(function (topSlot, index) {
+      return checkArena(topSlot, segments.filter(function (segment) {
+        return segment.arena === index;
+      }));
+    });
+    var free = collectFreeChunks(arenas, segments);
+
+    var tableSize = HEAP_SNAPSHOT_HEADER_SIZE +
+        tops.length * HEAP_ARENA_ENTRY_SIZE +
+        segments.length * HEAP_SEGMENT_ENTRY_SIZE +
+        free.length * HEAP_FREE_ENTRY_SIZE;
+    var table = Memory.alloc(tableSize);
+    Memory.writeU32(table, HEAP_SNAPSHOT_MAGIC);
+    Memory.writeU32(table.add(4), tops.length);
+    Memory.writeU32(table.add(8), segments.length);
+    Memory.writeU32(table.add(12), free.length);
+    var cursor = table.add(HEAP_SNAPSHOT_HEADER_SIZE);
+    tops.forEach(function (top) {
+      Memory.writePointer(cursor, top);
+      cursor = cursor.add(HEAP_ARENA_ENTRY_SIZE);
+    });
+    segments.forEach(function (segment) {
+      Memory.writeU64(cursor, 0);
+      Memory.writePointer(cursor, segment.start);
+      Memory.writeU64(cursor.add(8), segment.size);
+      Memory.writeU32(cursor.add(16), segment.arena);
+      Memory.writeU32(cursor.add(20), segment.flags);
+      cursor = cursor.add(HEAP_SEGMENT_ENTRY_SIZE);
+    });
+    free.forEach(function (chunk) {
+      Memory.writePointer(cursor, chunk);
+      cursor = cursor.add(HEAP_FREE_ENTRY_SIZE);
+    });
+
+    resolve([{
+      segments: segments.map(function (segment) {
+        return [segment.start.toString(), segment.size];
+      })
+    }, Memory.readByteArray(table, tableSize)]);
+  });
+};
+
+/*
+ * Hashes each page of [address, address + size) with SHA-256, replying
+ * with the 32-byte digests back to back. The range is read in one go; the
+ * host only asks for the pages whose digests it hasn't stored yet. A range
+ * that can't be read is reported as such rather than failing the request.
+ */
+handlers['snapshot:hash-pages'] = function (payload) {
+  return new Promise(function (resolve, reject) {
+    var pageSize = Process.pageSize;
+    var count = payload.size / pageSize;
+    var bytes;
+    try {
+      bytes = Memory.readByteArray(ptr(payload.address), payload.size);
+    } catch (e) {
+      resolve({ pageSize: pageSize, unreadable: true });
+      return;
+    }
+    var digests = new Uint32Array(count * 8);
+    for (var i = 0; i !== count; i++) {
+      sha256(new Uint32Array(bytes, i * pageSize, pageSize / 4), digests,
+          i * 8);
+    }
+    resolve([{ pageSize: pageSize }, digests.buffer]);
+  });
+};
+
+handlers['snapshot:read-pages'] = function (payload) {
+  return new Promise(function (resolve, reject) {
+    var pageSize = Process.pageSize;
+    var pages = new Uint8Array(payload.addresses.length * pageSize);
+    try {
+      payload.addresses.forEach(function (address, i) {
+        pages.set(new Uint8Array(Memory.readByteArray(ptr(address), pageSize)),
+            i * pageSize);
+      });
+    } catch (e) {
+      resolve({ unreadable: true });
+      return;
+    }
+    resolve([{}, pages.buffer]);
+  });
+};
+
 handlers['module:find-base-address'] = function (payload) {
   return new Promise(function (resolve, reject) {
     var address = Module.findBaseAddress(payload.moduleName);
-    resolve({ baseAddress: (address !== null) ? address : "0" });
+    resolve([{}, packAddresses([(address !== null) ? address : ptr(0)])]);
   });
 };
 
@@ -74,14 +223,19 @@ handlers['memory:write-utf8'] = function (payload) {
 
 handlers['module:enumerate-exports'] = function (payload) {
   return new Promise(function (resolve, reject) {
-    var exports = [];
+    var names = [];
+    var types = [];
+    var addresses = [];
     Module.enumerateExports(payload.modulePath, {
       onMatch: function (e) {
-        if (e.type === 'function')
-          exports.push(e);
+        if (e.type === 'function') {
+          names.push(e.name);
+          types.push(e.type);
+          addresses.push(e.address);
+        }
       },
       onComplete: function () {
-        resolve({ exports: exports });
+        resolve([{ names: names, types: types }, packAddresses(addresses)]);
       }
     });
   });
@@ -89,18 +243,1186 @@ handlers['module:enumerate-exports'] = function (payload) {
 
 handlers['module:enumerate-ranges'] = function (payload) {
   return new Promise(function (resolve, reject) {
-    var ranges = [];
+    var ranges = createRangeColumns();
     Module.enumerateRanges(payload.modulePath, payload.protection, {
-      onMatch: function (r) {
-        ranges.push(r);
-      },
+      onMatch: ranges.add,
       onComplete: function () {
-        resolve({ ranges: ranges });
+        resolve(ranges.finish());
       }
     });
   });
 };
 
+var arenas = {};
+var nextArenaId = 1;
+
+handlers['memory:alloc'] = function (payload) {
+  return new Promise(function (resolve, reject) {
+    var id = payload.arena || nextArenaId++;
+    var chunks = arenas[id];
+    if (chunks === undefined) {
+      chunks = [];
+      arenas[id] = chunks;
+    }
+    var addresses = payload.sizes.map(function (size) {
+      var chunk = Memory.alloc(size);
+      chunks.push(chunk);
+      return chunk;
+    });
+    resolve([{ arena: id }, packAddresses(addresses)]);
+  });
+};
+
+handlers['memory:free'] = function (payload) {
+  return new Promise(function (resolve, reject) {
+    // Chunks are returned to the heap once the GC sees they're unreferenced.
+    delete arenas[payload.arena];
+    resolve({});
+  });
+};
+
+handlers['memory:write-batch'] = function (payload) {
+  return new Promise(function (resolve, reject) {
+    var bytes = decodeBase64(payload.data);
+    payload.writes.forEach(function (w) {
+      var offset = w[1];
+      var length = w[2];
+      Memory.writeByteArray(ptr(w[0]),
+          bytes.buffer.slice(offset, offset + length));
+    });
+    resolve({});
+  });
+};
+
+var patches = {};
+var nextPatchId = 1;
+
+/*
+ * Patches arrive sorted by address and are grouped into page spans, so each
+ * span gets one protection change (and, where Memory.patchCode() exists,
+ * one instruction cache flush). A failure part-way restores what was
+ * already written.
+ */
+handlers['memory:patch'] = function (payload) {
+  return new Promise(function (resolve, reject) {
+    if (payload.suspendThreads)
+      throw new Error('Suspending threads is not supported by this agent');
+
+    var bytes = decodeBase64(payload.data);
+    var spans = groupPatchesByPage(payload.patches);
+    var applied = [];
+    try {
+      spans.forEach(function (span) {
+        var saved = span.patches.map(function (p) {
+          var address = ptr(p[0]);
+          return {
+            address: address,
+            original: toByteArray(Memory.readByteArray(address, p[2]))
+          };
+        });
+        patchSpan(span.start, span.size, function (code) {
+          span.patches.forEach(function (p) {
+            var offset = p[1];
+            var length = p[2];
+            Memory.writeByteArray(code.add(ptr(p[0]).sub(span.start)),
+                bytes.buffer.slice(offset, offset + length));
+          });
+        });
+        applied.push({ start: span.start, size: span.size, saved: saved });
+      });
+    } catch (e) {
+      revertSpans(applied);
+      throw e;
+    }
+
+    var id = nextPatchId++;
+    patches[id] = applied;
+    resolve({ id: id, pages: applied.length });
+  });
+};
+
+handlers['memory:unpatch'] = function (payload) {
+  return new Promise(function (resolve, reject) {
+    var applied = patches[payload.id];
+    if (applied === undefined)
+      throw new Error('Unknown patch');
+    delete patches[payload.id];
+    revertSpans(applied);
+    resolve({});
+  });
+};
+
+function groupPatchesByPage(entries) {
+  var pageSize = Process.pageSize;
+  var spans = [];
+  var current = null;
+  entries.forEach(function (p) {
+    var address = ptr(p[0]);
+    var end = address.add(p[2]);
+    if (current !== null && address.compare(current.end) < 0) {
+      if (end.compare(current.end) > 0)
+        current.end = roundUpToPage(end, pageSize);
+      current.patches.push(p);
+    } else {
+      current = {
+        start: address.sub(address.and(pageSize - 1)),
+        end: roundUpToPage(end, pageSize),
+        patches: [p]
+      };
+      spans.push(current);
+    }
+  });
+  spans.forEach(function (span) {
+    span.size = span.end.sub(span.start).toInt32();
+  });
+  return spans;
+}
+
+function roundUpToPage(address, pageSize) {
+  var remainder = address.and(pageSize - 1);
+  return remainder.isNull() ? address : address.sub(remainder).add(pageSize);
+}
+
+function patchSpan(start, size, apply) {
+  if (typeof Memory.patchCode === 'function') {
+    Memory.patchCode(start, size, apply);
+    return;
+  }
+
+  var pieces = protectionsOf(start, size);
+  Memory.protect(start, size, 'rwx');
+  try {
+    apply(start);
+  } finally {
+    pieces.forEach(function (piece) {
+      Memory.protect(piece.address, piece.size, piece.protection);
+    });
+  }
+}
+
+/*
+ * The current protection of every mapping that [start, start + size)
+ * overlaps, so it can be put back exactly once the span is written.
+ */
+function protectionsOf(start, size) {
+  if (typeof Process.findRangeByAddress !== 'function')
+    throw new Error('Unable to determine page protection in this runtime');
+
+  var end = start.add(size);
+  var pieces = [];
+  var cursor = start;
+  while (cursor.compare(end) < 0) {
+    var range = Process.findRangeByAddress(cursor);
+    if (range === null)
+      throw new Error('Unable to patch unmapped memory at ' + cursor);
+    var rangeEnd = range.base.add(range.size);
+    var pieceEnd = (rangeEnd.compare(end) < 0) ? rangeEnd : end;
+    pieces.push({
+      address: cursor,
+      size: pieceEnd.sub(cursor).toInt32(),
+      protection: range.protection
+    });
+    cursor = pieceEnd;
+  }
+  return pieces;
+}
+
+/*
+ * Restores only the bytes each patch replaced, newest first, so other
+ * writes that landed on the same pages since are left alone.
+ */
+function revertSpans(applied) {
+  applied.slice().reverse().forEach(function (span) {
+    patchSpan(span.start, span.size, function (code) {
+      span.saved.slice().reverse().forEach(function (entry) {
+        Memory.writeByteArray(code.add(entry.address.sub(span.start)),
+            entry.original);
+      });
+    });
+  });
+}
+
+function toByteArray(buffer) {
+  return Array.prototype.slice.call(new Uint8Array(buffer));
+}
+
+var nativeFunctions = {};
+
+handlers['function:call'] = function (payload) {
+  return new Promise(function (resolve, reject) {
+    var calls = payload.calls;
+    var size = calls.length * 8;
+    var results = Memory.alloc(size);
+    calls.forEach(function (call, i) {
+      var f = getNativeFunction(call);
+      var args = call.args.map(function (value, j) {
+        return decodeArgument(call.argumentTypes[j], value);
+      });
+      writeSlot(results.add(i * 8), call.returnType, f.apply(null, args));
+    });
+    resolve([{}, Memory.readByteArray(results, size)]);
+  });
+};
+
+function getNativeFunction(call) {
+  var key = [call.address, call.returnType, call.argumentTypes.join(','),
+      call.abi].join(':');
+  var f = nativeFunctions[key];
+  if (f === undefined) {
+    f = new NativeFunction(ptr(call.address), call.returnType,
+        call.argumentTypes, call.abi);
+    nativeFunctions[key] = f;
+  }
+  return f;
+}
+
+function decodeArgument(type, value) {
+  switch (type) {
+    case 'pointer':
+      return ptr(value);
+    case 'int64':
+      return decodeWide(value, true);
+    case 'uint64':
+      return decodeWide(value, false);
+    case 'long':
+      return (longSize() === 8) ? decodeWide(value, true) : parseInt(value, 10);
+    case 'ulong':
+      return (longSize() === 8) ? decodeWide(value, false) : parseInt(value, 10);
+    default:
+      return value;
+  }
+}
+
+/*
+ * C long is pointer-sized everywhere except on LLP64 (64-bit Windows), where
+ * it stays 32 bits wide.
+ */
+function longSize() {
+  return (Process.platform === 'windows') ? 4 : Process.pointerSize;
+}
+
+function decodeWide(value, signed) {
+  if (signed && typeof int64 === 'function')
+    return int64(value);
+  if (!signed && typeof uint64 === 'function')
+    return uint64(value);
+  var n = parseInt(value, 10);
+  if (Math.abs(n) > 9007199254740991)
+    throw new Error('64-bit argument ' + value + ' cannot be represented in this runtime');
+  return n;
+}
+
+function writeSlot(slot, type, value) {
+  Memory.writeU64(slot, 0);
+  switch (type) {
+    case 'void':
+      break;
+    case 'pointer':
+      Memory.writePointer(slot, value);
+      break;
+    case 'int64':
+    case 'long':
+      Memory.writeS64(slot, value);
+      break;
+    case 'uint64':
+    case 'ulong':
+      Memory.writeU64(slot, value);
+      break;
+    case 'float':
+      Memory.writeFloat(slot, value);
+      break;
+    case 'double':
+      Memory.writeDouble(slot, value);
+      break;
+    case 'char':
+    case 'int8':
+      Memory.writeS8(slot, value);
+      break;
+    case 'uchar':
+    case 'uint8':
+      Memory.writeU8(slot, value);
+      break;
+    case 'int16':
+      Memory.writeS16(slot, value);
+      break;
+    case 'uint16':
+      Memory.writeU16(slot, value);
+      break;
+    case 'uint':
+    case 'uint32':
+      Memory.writeU32(slot, value);
+      break;
+    default:
+      Memory.writeS32(slot, value);
+      break;
+  }
+}
+
+var latencyProfilers = {};
+var nextLatencyProfilerId = 1;
+var clock = null;
+
+/*
+ * Hooks each target and aggregates call latency into log-linear histograms
+ * keyed by function and thread. Only the histograms leave the process,
+ * as a binary flush every `interval` ms.
+ */
+handlers['profile:latency-start'] = function (payload) {
+  return new Promise(function (resolve, reject) {
+    if (clock === null)
+      clock = createClock();
+
+    var id = nextLatencyProfilerId++;
+    var profiler = {
+      topic: 'latency:' + id,
+      histograms: {},
+      listeners: [],
+      timer: null
+    };
+    payload.targets.forEach(function (address, index) {
+      profiler.listeners.push(Interceptor.attach(ptr(address), {
+        onEnter: function () {
+          this.latencyStart = clock();
+        },
+        onLeave: function () {
+          recordLatency(profiler, index, Process.getCurrentThreadId(),
+              clock() - this.latencyStart);
+        }
+      }));
+    });
+    profiler.timer = setInterval(function () {
+      flushLatency(profiler);
+    }, payload.interval);
+    latencyProfilers[id] = profiler;
+
+    resolve({ id: id, topic: profiler.topic });
+  });
+};
+
+handlers['profile:latency-stop'] = function (payload) {
+  return new Promise(function (resolve, reject) {
+    var profiler = latencyProfilers[payload.id];
+    if (profiler === undefined)
+      throw new Error('Unknown profiler');
+    delete latencyProfilers[payload.id];
+
+    clearInterval(profiler.timer);
+    profiler.listeners.forEach(function (listener) {
+      if (typeof listener.detach === 'function')
+        listener.detach();
+    });
+    flushLatency(profiler);
+
+    resolve({});
+  });
+};
+
+var lockProfilers = {};
+var nextLockProfilerId = 1;
+
+var LOCK_KIND_MUTEX = 0;
+var LOCK_KIND_RWLOCK = 1;
+var LOCK_KIND_COND = 2;
+
+/*
+ * Hooks the pthread mutex, rwlock and condition variable primitives and
+ * aggregates wait time (entering lock until it returns) and hold time
+ * (lock returning until unlock) per lock address and acquiring call site.
+ */
+handlers['profile:locks-start'] = function (payload) {
+  return new Promise(function (resolve, reject) {
+    if (Process.platform !== 'linux')
+      throw new Error('Lock profiling is only supported on Linux');
+    if (clock === null)
+      clock = createClock();
+
+    var id = nextLockProfilerId++;
+    var profiler = {
+      topic: 'locks:' + id,
+      threshold: payload.contentionThreshold,
+      stats: {},
+      held: {},
+      listeners: [],
+      timer: null
+    };
+
+    function hook(name, callbacks) {
+      var address = Module.findExportByName(null, name);
+      if (address !== null)
+        profiler.listeners.push(Interceptor.attach(address, callbacks));
+    }
+
+    function acquire(kind) {
+      return {
+        onEnter: function (args) {
+          this.lock = args[0];
+          this.site = this.returnAddress;
+          this.waitStart = clock();
+        },
+        onLeave: function (retval) {
+          if (retval.toInt32() !== 0)
+            return;
+          var now = clock();
+          recordLockWait(profiler, kind, this.lock, this.site,
+              now - this.waitStart);
+          beginLockHold(profiler, kind, this.lock, this.site, now);
+        }
+      };
+    }
+
+    function release(kind) {
+      return {
+        onEnter: function (args) {
+          endLockHold(profiler, kind, args[0], clock());
+        }
+      };
+    }
+
+    function tryAcquire(kind) {
+      return {
+        onEnter: function (args) {
+          this.lock = args[0];
+          this.site = this.returnAddress;
+        },
+        onLeave: function (retval) {
+          if (retval.toInt32() !== 0)
+            return;
+          recordLockWait(profiler, kind, this.lock, this.site, 0);
+          beginLockHold(profiler, kind, this.lock, this.site, clock());
+        }
+      };
+    }
+
+    // The mutex is released while waiting and re-acquired on return.
+    var condWait = {
+      onEnter: function (args) {
+        this.cond = args[0];
+        this.mutex = args[1];
+        this.site = this.returnAddress;
+        this.waitStart = clock();
+        endLockHold(profiler, LOCK_KIND_MUTEX, this.mutex, this.waitStart);
+      },
+      onLeave: function (retval) {
+        var now = clock();
+        recordLockWait(profiler, LOCK_KIND_COND, this.cond, this.site,
+            now - this.waitStart);
+        beginLockHold(profiler, LOCK_KIND_MUTEX, this.mutex, this.site, now);
+      }
+    };
+
+    hook('pthread_mutex_lock', acquire(LOCK_KIND_MUTEX));
+    hook('pthread_mutex_trylock', tryAcquire(LOCK_KIND_MUTEX));
+    hook('pthread_mutex_unlock', release(LOCK_KIND_MUTEX));
+    hook('pthread_rwlock_rdlock', acquire(LOCK_KIND_RWLOCK));
+    hook('pthread_rwlock_wrlock', acquire(LOCK_KIND_RWLOCK));
+    hook('pthread_rwlock_unlock', release(LOCK_KIND_RWLOCK));
+    hook('pthread_cond_wait', condWait);
+    hook('pthread_cond_timedwait', condWait);
+
+    profiler.timer = setInterval(function () {
+      flushLocks(profiler);
+    }, payload.interval);
+    lockProfilers[id] = profiler;
+
+    resolve({ id: id, topic: profiler.topic });
+  });
+};
+
+handlers['profile:locks-stop'] = function (payload) {
+  return new Promise(function (resolve, reject) {
+    var profiler = lockProfilers[payload.id];
+    if (profiler === undefined)
+      throw new Error('Unknown profiler');
+    delete lockProfilers[payload.id];
+
+    clearInterval(profiler.timer);
+    profiler.listeners.forEach(function (listener) {
+      if (typeof listener.detach === 'function')
+        listener.detach();
+    });
+    flushLocks(profiler);
+
+    resolve({});
+  });
+};
+
+function lockStats(profiler, kind, lock, site) {
+  var key = lock + ':' + site;
+  var stats = profiler.stats[key];
+  if (stats === undefined) {
+    stats = {
+      kind: kind,
+      lock: lock,
+      site: site,
+      acquisitions: 0,
+      contended: 0,
+      waitSum: 0,
+      waitMax: 0,
+      holdSum: 0,
+      holdMax: 0
+    };
+    profiler.stats[key] = stats;
+  }
+  return stats;
+}
+
+function recordLockWait(profiler, kind, lock, site, wait) {
+  var stats = lockStats(profiler, kind, lock, site);
+  stats.acquisitions++;
+  if (wait >= profiler.threshold)
+    stats.contended++;
+  stats.waitSum += wait;
+  if (wait > stats.waitMax)
+    stats.waitMax = wait;
+}
+
+function beginLockHold(profiler, kind, lock, site, now) {
+  var key = Process.getCurrentThreadId() + ':' + lock;
+  var hold = profiler.held[key];
+  if (hold !== undefined) {
+    hold.depth++;
+    return;
+  }
+  profiler.held[key] = { kind: kind, site: site, start: now, depth: 1 };
+}
+
+function endLockHold(profiler, kind, lock, now) {
+  var key = Process.getCurrentThreadId() + ':' + lock;
+  var hold = profiler.held[key];
+  if (hold === undefined || --hold.depth > 0)
+    return;
+  delete profiler.held[key];
+
+  var stats = lockStats(profiler, hold.kind, lock, hold.site);
+  var duration = now - hold.start;
+  stats.holdSum += duration;
+  if (duration > stats.holdMax)
+    stats.holdMax = duration;
+}
+
+/*
+ * Layout: u32 record count, then 64-byte records of u64 lock, u64 call
+ * site, u32 kind, u32 acquisitions, u32 contended, u32 padding, f64 wait
+ * sum, f64 wait max, f64 hold sum, f64 hold max.
+ */
+function flushLocks(profiler) {
+  var stats = profiler.stats;
+  var keys = Object.keys(stats);
+  if (keys.length === 0)
+    return;
+  profiler.stats = {};
+
+  var size = 4 + keys.length * 64;
+  var buffer = Memory.alloc(size);
+  Memory.writeU32(buffer, keys.length);
+  var cursor = buffer.add(4);
+  keys.forEach(function (key) {
+    var s = stats[key];
+    writeSlot(cursor, 'pointer', s.lock);
+    writeSlot(cursor.add(8), 'pointer', s.site);
+    Memory.writeU32(cursor.add(16), s.kind);
+    Memory.writeU32(cursor.add(20), s.acquisitions);
+    Memory.writeU32(cursor.add(24), s.contended);
+    Memory.writeU32(cursor.add(28), 0);
+    Memory.writeDouble(cursor.add(32), s.waitSum);
+    Memory.writeDouble(cursor.add(40), s.waitMax);
+    Memory.writeDouble(cursor.add(48), s.holdSum);
+    Memory.writeDouble(cursor.add(56), s.holdMax);
+    cursor = cursor.add(64);
+  });
+
+  notify(profiler.topic, {}, Memory.readByteArray(buffer, size));
+}
+
+var LATENCY_SUB_BUCKETS = 8;
+var LATENCY_MAX_BUCKET = 511;
+
+function latencyBucket(ns) {
+  var value = Math.floor(ns);
+  if (value < 2 * LATENCY_SUB_BUCKETS)
+    return Math.max(value, 0);
+  var shift = 0;
+  while (value >= 2 * LATENCY_SUB_BUCKETS) {
+    value = Math.floor(value / 2);
+    shift++;
+  }
+  return Math.min(shift * LATENCY_SUB_BUCKETS + value, LATENCY_MAX_BUCKET);
+}
+
+function recordLatency(profiler, index, threadId, ns) {
+  var key = index + ':' + threadId;
+  var histogram = profiler.histograms[key];
+  if (histogram === undefined) {
+    histogram = {
+      index: index,
+      threadId: threadId,
+      counts: {},
+      buckets: 0,
+      sum: 0,
+      max: 0
+    };
+    profiler.histograms[key] = histogram;
+  }
+  var bucket = latencyBucket(ns);
+  if (histogram.counts[bucket] === undefined) {
+    histogram.counts[bucket] = 1;
+    histogram.buckets++;
+  } else {
+    histogram.counts[bucket]++;
+  }
+  histogram.sum += ns;
+  if (ns > histogram.max)
+    histogram.max = ns;
+}
+
+/*
+ * Layout: u32 record count, then per record u32 function index, u32 thread
+ * id, u32 bucket count, u32 padding, f64 sum, f64 max, followed by
+ * (u32 bucket, u32 count) pairs.
+ */
+function flushLatency(profiler) {
+  var histograms = profiler.histograms;
+  var keys = Object.keys(histograms);
+  if (keys.length === 0)
+    return;
+  profiler.histograms = {};
+
+  var size = 4;
+  keys.forEach(function (key) {
+    size += 32 + histograms[key].buckets * 8;
+  });
+
+  var buffer = Memory.alloc(size);
+  Memory.writeU32(buffer, keys.length);
+  var cursor = buffer.add(4);
+  keys.forEach(function (key) {
+    var h = histograms[key];
+    Memory.writeU32(cursor, h.index);
+    Memory.writeU32(cursor.add(4), h.threadId);
+    Memory.writeU32(cursor.add(8), h.buckets);
+    Memory.writeU32(cursor.add(12), 0);
+    Memory.writeDouble(cursor.add(16), h.sum);
+    Memory.writeDouble(cursor.add(24), h.max);
+    cursor = cursor.add(32);
+    Object.keys(h.counts).forEach(function (bucket) {
+      Memory.writeU32(cursor, parseInt(bucket, 10));
+      Memory.writeU32(cursor.add(4), h.counts[bucket]);
+      cursor = cursor.add(8);
+    });
+  });
+
+  notify(profiler.topic, {}, Memory.readByteArray(buffer, size));
+}
+
+/*
+ * Returns a monotonic clock in nanoseconds, relative to its creation so the
+ * values stay well within double precision.
+ */
+function createClock() {
+  var now;
+  if (Process.platform === 'windows') {
+    var kernel32 = 'kernel32.dll';
+    var query = new NativeFunction(
+        Module.findExportByName(kernel32, 'QueryPerformanceCounter'),
+        'int', ['pointer'], 'stdcall');
+    var frequencyOf = new NativeFunction(
+        Module.findExportByName(kernel32, 'QueryPerformanceFrequency'),
+        'int', ['pointer'], 'stdcall');
+    var counter = Memory.alloc(8);
+    frequencyOf(counter);
+    var nsPerTick = 1e9 / readU64AsNumber(counter);
+    now = function () {
+      query(counter);
+      return readU64AsNumber(counter) * nsPerTick;
+    };
+  } else {
+    var clockGettime = Module.findExportByName(null, 'clock_gettime');
+    if (clockGettime !== null) {
+      var gettime = new NativeFunction(clockGettime, 'int', ['int', 'pointer']);
+      var CLOCK_MONOTONIC = (Process.platform === 'darwin') ? 6 : 1;
+      var timespec = Memory.alloc(2 * Process.pointerSize);
+      now = function () {
+        gettime(CLOCK_MONOTONIC, timespec);
+        return Memory.readU32(timespec) * 1e9 +
+            Memory.readU32(timespec.add(Process.pointerSize));
+      };
+    } else {
+      now = function () {
+        return Date.now() * 1e6;
+      };
+    }
+  }
+
+  var origin = now();
+  return function () {
+    return now() - origin;
+  };
+}
+
+var SHA256_K = new Int32Array([
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+  0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+  0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+  0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+  0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+  0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+]);
+var SHA256_H = new Int32Array([
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c,
+  0x1f83d9ab, 0x5be0cd19
+]);
+var sha256State = new Int32Array(8);
+var sha256Schedule = new Int32Array(64);
+
+/*
+ * SHA-256 of `words`, whose byte length must be a multiple of 64, as pages
+ * always are. The digest is stored as eight words at out[offset], laid out
+ * so that its bytes come out in the usual order.
+ */
+function sha256(words, out, offset) {
+  var h = sha256State;
+  var w = sha256Schedule;
+  h.set(SHA256_H);
+
+  for (var i = 0; i !== words.length; i += 16) {
+    for (var t = 0; t !== 16; t++)
+      w[t] = byteSwap32(words[i + t]);
+    sha256Block(h, w);
+  }
+
+  var bits = words.length * 32;
+  w[0] = 0x80000000 | 0;
+  for (var z = 1; z !== 14; z++)
+    w[z] = 0;
+  w[14] = Math.floor(bits / 4294967296);
+  w[15] = bits | 0;
+  sha256Block(h, w);
+
+  for (var j = 0; j !== 8; j++)
+    out[offset + j] = byteSwap32(h[j]);
+}
+
+function sha256Block(h, w) {
+  var t;
+  for (t = 16; t !== 64; t++) {
+    var w15 = w[t - 15];
+    var w2 = w[t - 2];
+    var s0 = rotr32(w15, 7) ^ rotr32(w15, 18) ^ (w15 >>> 3);
+    var s1 = rotr32(w2, 17) ^ rotr32(w2, 19) ^ (w2 >>> 10);
+    w[t] = (w[t - 16] + s0 + w[t - 7] + s1) | 0;
+  }
+
+  var a = h[0], b = h[1], c = h[2], d = h[3];
+  var e = h[4], f = h[5], g = h[6], k = h[7];
+  for (t = 0; t !== 64; t++) {
+    var t1 = (k + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) +
+        ((e & f) ^ (~e & g)) + SHA256_K[t] + w[t]) | 0;
+    var t2 = ((rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) +
+        ((a & b) ^ (a & c) ^ (b & c))) | 0;
+    k = g;
+    g = f;
+    f = e;
+    e = (d + t1) | 0;
+    d = c;
+    c = b;
+    b = a;
+    a = (t1 + t2) | 0;
+  }
+
+  h[0] = (h[0] + a) | 0;
+  h[1] = (h[1] + b) | 0;
+  h[2] = (h[2] + c) | 0;
+  h[3] = (h[3] + d) | 0;
+  h[4] = (h[4] + e) | 0;
+  h[5] = (h[5] + f) | 0;
+  h[6] = (h[6] + g) | 0;
+  h[7] = (h[7] + k) | 0;
+}
+
+function rotr32(x, r) {
+  return (x >>> r) | (x << (32 - r));
+}
+
+function byteSwap32(x) {
+  return (x >>> 24) | ((x >>> 8) & 0xff00) | ((x & 0xff00) << 8) | (x << 24);
+}
+
+var HEAP_SNAPSHOT_MAGIC = 0x50414548;
+var HEAP_SNAPSHOT_HEADER_SIZE = 16;
+var HEAP_ARENA_ENTRY_SIZE = 8;
+var HEAP_SEGMENT_ENTRY_SIZE = 24;
+var HEAP_FREE_ENTRY_SIZE = 8;
+var HEAP_SEGMENT_INITIAL = 1;
+var HEAP_FASTBIN_COUNT = 10;
+var HEAP_MAX_SIZE = 64 * 1024 * 1024;
+var HEAP_INFO_SIZE = 32;
+var ARENA_FASTBINS_SIZE = 80;
+var ARENA_NEXT_OFFSET = 2064;
+var ARENA_SIZE_AFTER_TOP = 2104;
+var ARENA_TOP_OFFSETS = [96, 88];
+var MAX_ARENAS = 256;
+var MAX_HEAPS_PER_ARENA = 1024;
+var MAX_FREE_LIST_LENGTH = 65536;
+var CHUNK_HEADER_SIZE = 16;
+var CHUNK_MIN_SIZE = 16;
+var TCACHE_BIN_COUNT = 64;
+var TCACHE_STRUCT_CHUNK_SIZE = 0x290;
+var TCACHE_STRUCT_CHUNK_SIZE_LEGACY = 0x250;
+
+/*
+ * main_arena is not exported, so look for it in libc's writable data: its
+ * top chunk is the one that ends at the current program break. The offset
+ * of the top field differs across glibc versions; the right one is the one
+ * for which the arena list loops back to main_arena.
+ */
+function findMainArena() {
+  var sbrk = new NativeFunction(Module.findExportByName(null, 'sbrk'),
+      'pointer', ['pointer']);
+  var heapEnd = sbrk(ptr(0));
+  var writable = Process.enumerateRangesSync('rw-');
+  var heapRange = writable.filter(function (r) {
+    return heapEnd.compare(r.base) > 0 &&
+        heapEnd.compare(r.base.add(r.size)) <= 0;
+  })[0];
+  if (heapRange === undefined)
+    throw new Error('No malloc heap found');
+  var heapStart = heapRange.base;
+  var start = toNumber(heapStart);
+  var end = toNumber(heapEnd);
+
+  var libc = Process.enumerateModulesSync().filter(function (m) {
+    return /^libc[.-]/.test(m.name);
+  })[0];
+  if (libc === undefined)
+    throw new Error('Heap inspection requires glibc on 64-bit Linux');
+  var libcEnd = libc.base.add(libc.size);
+
+  var ranges = writable.filter(function (r) {
+    return r.base.compare(libc.base) >= 0 && r.base.compare(libcEnd) < 0;
+  });
+  for (var i = 0; i !== ranges.length; i++) {
+    var range = ranges[i];
+    var words = new Uint32Array(Memory.readByteArray(range.base, range.size));
+    for (var j = 0; j + 1 < words.length; j += 2) {
+      var top = words[j + 1] * 4294967296 + words[j];
+      if (top < start || top >= end || top % 16 !== 0)
+        continue;
+      var topSize = readU64AsNumber(ptr('0x' + (top + 8).toString(16)));
+      if (top + topSize - (topSize % 8) !== end)
+        continue;
+
+      var topSlot = range.base.add(j * 4);
+      for (var k = 0; k !== ARENA_TOP_OFFSETS.length; k++) {
+        var topOffset = ARENA_TOP_OFFSETS[k];
+        var base = topSlot.sub(topOffset);
+        if (arenaListLoopsBack(base, topOffset)) {
+          return {
+            base: base,
+            topSlot: topSlot,
+            topOffset: topOffset,
+            heapStart: heapStart,
+            heapEnd: heapEnd
+          };
+        }
+      }
+    }
+  }
+  throw new Error('Unable to locate main_arena');
+}
+
+function arenaListLoopsBack(base, topOffset) {
+  try {
+    var arena = base;
+    for (var i = 0; i !== MAX_ARENAS; i++) {
+      arena = Memory.readPointer(arena.add(topOffset + ARENA_NEXT_OFFSET));
+      if (arena.equals(base))
+        return true;
+      if (arena.isNull())
+        return false;
+    }
+  } catch (e) {
+  }
+  return false;
+}
+
+/*
+ * Non-main arenas live in HEAP_MAX_SIZE-aligned mmap()ed heaps, each
+ * starting with a heap_info and linked to the previous one. The first heap
+ * also holds the arena itself, with the chunks following it.
+ */
+function collectArenaHeaps(arena, topSlot, topOffset, index, segments) {
+  var top = Memory.readPointer(topSlot);
+  var heap = top.sub(top.and(HEAP_MAX_SIZE - 1));
+  for (var i = 0; i !== MAX_HEAPS_PER_ARENA && !heap.isNull(); i++) {
+    if (!Memory.readPointer(heap).equals(arena))
+      break;
+    var prev = Memory.readPointer(heap.add(8));
+    var size = readU64AsNumber(heap.add(16));
+    var chunks = prev.isNull()
+        ? alignUp(arena.add(topOffset + ARENA_SIZE_AFTER_TOP), 16)
+        : heap.add(HEAP_INFO_SIZE);
+    segments.push({
+      start: chunks,
+      size: size - toNumber(chunks.sub(heap)),
+      arena: index,
+      flags: prev.isNull() ? HEAP_SEGMENT_INITIAL : 0
+    });
+    heap = prev;
+  }
+}
+
+/*
+ * The malloc_state offsets above are only confirmed by the arena list
+ * looping back, so each arena's top chunk must lie within one of its heap
+ * segments with a size that fits, and its fastbin heads must point into
+ * them too, before anything is read through them.
+ */
+function checkArena(topSlot, arenaSegments) {
+  var top = Memory.readPointer(topSlot);
+  var segment = findSegment(arenaSegments, top);
+  if (segment === null || !top.and(15).isNull())
+    throw new Error('Unrecognized malloc_state layout');
+  var topSize = readU64AsNumber(top.add(8));
+  topSize -= topSize % 8;
+  if (topSize < CHUNK_MIN_SIZE || topSize % 16 !== 0 ||
+      top.add(topSize).compare(segment.start.add(segment.size)) > 0)
+    throw new Error('Unrecognized malloc_state layout');
+
+  var fastbins = topSlot.sub(ARENA_FASTBINS_SIZE);
+  for (var i = 0; i !== HEAP_FASTBIN_COUNT; i++) {
+    var head = Memory.readPointer(fastbins.add(i * 8));
+    if (!head.isNull() && (findSegment(arenaSegments, head) === null ||
+        !head.and(15).isNull()))
+      throw new Error('Unrecognized malloc_state layout');
+  }
+
+  return top;
+}
+
+/*
+ * Fastbin and tcache chunks keep their in-use bit set, so the host can
+ * only tell them apart by address; the lists are followed here, where
+ * they can be read in place. The tcache_perthread_struct of the first
+ * thread on an arena is the first chunk of its initial heap. Caches of
+ * other threads on the same arena are indistinguishable from ordinary
+ * allocations and count as in use.
+ */
+function collectFreeChunks(arenas, segments) {
+  var seen = {};
+  var chunks = [];
+
+  // Fastbin links point at chunks, tcache ones at their user data.
+  var follow = function (chunk, linkOffset) {
+    try {
+      for (var n = 0; !chunk.isNull() && n !== MAX_FREE_LIST_LENGTH; n++) {
+        var key = chunk.toString();
+        if (seen[key] === true || findSegment(segments, chunk) === null)
+          return;
+        seen[key] = true;
+        chunks.push(chunk);
+        var field = chunk.add(CHUNK_HEADER_SIZE);
+        var next = reveal(field, Memory.readPointer(field), segments);
+        chunk = next.isNull() ? next : next.sub(linkOffset);
+      }
+    } catch (e) {
+    }
+  };
+
+  arenas.forEach(function (topSlot) {
+    var fastbins = topSlot.sub(ARENA_FASTBINS_SIZE);
+    for (var i = 0; i !== HEAP_FASTBIN_COUNT; i++)
+      follow(Memory.readPointer(fastbins.add(i * 8)), 0);
+  });
+
+  segments.forEach(function (segment) {
+    if ((segment.flags & HEAP_SEGMENT_INITIAL) === 0)
+      return;
+    var size = readU64AsNumber(segment.start.add(8));
+    size -= size % 8;
+    var countsSize;
+    if (size === TCACHE_STRUCT_CHUNK_SIZE)
+      countsSize = TCACHE_BIN_COUNT * 2;
+    else if (size === TCACHE_STRUCT_CHUNK_SIZE_LEGACY)
+      countsSize = TCACHE_BIN_COUNT;
+    else
+      return;
+    var entries = segment.start.add(CHUNK_HEADER_SIZE + countsSize);
+    for (var i = 0; i !== TCACHE_BIN_COUNT; i++) {
+      var entry = Memory.readPointer(entries.add(i * 8));
+      if (!entry.isNull())
+        follow(entry.sub(CHUNK_HEADER_SIZE), CHUNK_HEADER_SIZE);
+    }
+  });
+
+  return chunks;
+}
+
+// glibc 2.32 and newer mangle singly linked list pointers with the address
+// of the field holding them. User space addresses fit in 47 bits, so plain
+// numbers are exact here.
+function reveal(field, value, segments) {
+  if (value.isNull() || findSegment(segments, value) !== null)
+    return value;
+  var key = Math.floor(toNumber(field) / 4096);
+  var mangled = toNumber(value);
+  var high = (Math.floor(key / 4294967296) ^
+      Math.floor(mangled / 4294967296)) >>> 0;
+  var low = ((key >>> 0) ^ (mangled >>> 0)) >>> 0;
+  var revealed = ptr('0x' + (high * 4294967296 + low).toString(16));
+  return (findSegment(segments, revealed) !== null) ? revealed : ptr(0);
+}
+
+function findSegment(segments, address) {
+  for (var i = 0; i !== segments.length; i++) {
+    var segment = segments[i];
+    if (address.compare(segment.start) >= 0 &&
+        address.compare(segment.start.add(segment.size)) < 0)
+      return segment;
+  }
+  return null;
+}
+
+function alignUp(address, alignment) {
+  var remainder = address.and(alignment - 1);
+  return remainder.isNull() ? address : address.sub(remainder).add(alignment);
+}
+
+function toNumber(address) {
+  return parseInt(address.toString(), 16);
+}
+
+var PT_LOAD = 1;
+var PT_NOTE = 4;
+var NT_GNU_BUILD_ID = 3;
+
+/*
+ * Reads the GNU build-id note of an ELF image mapped at `base`, or returns
+ * null if there is none or the image is not ELF.
+ */
+function readBuildId(base) {
+  if (Process.platform !== 'linux')
+    return null;
+
+  try {
+    if (Memory.readU32(base) !== 0x464c457f)
+      return null;
+    var is64 = Memory.readU8(base.add(4)) === 2;
+    var phoff = is64 ? readU64AsNumber(base.add(0x20)) : Memory.readU32(base.add(0x1c));
+    var phentsize = Memory.readU16(base.add(is64 ? 0x36 : 0x2a));
+    var phnum = Memory.readU16(base.add(is64 ? 0x38 : 0x2c));
+
+    var notes = [];
+    var firstLoad = -1;
+    for (var i = 0; i !== phnum; i++) {
+      var ph = base.add(phoff + i * phentsize);
+      var type = Memory.readU32(ph);
+      var vaddr = is64 ? readU64AsNumber(ph.add(0x10)) : Memory.readU32(ph.add(8));
+      var size = is64 ? readU64AsNumber(ph.add(0x20)) : Memory.readU32(ph.add(0x10));
+      if (type === PT_LOAD && firstLoad === -1)
+        firstLoad = vaddr - (vaddr % Process.pageSize);
+      else if (type === PT_NOTE)
+        notes.push([vaddr, size]);
+    }
+    if (firstLoad === -1)
+      return null;
+
+    for (var j = 0; j !== notes.length; j++) {
+      var buildId = findBuildIdNote(base.add(notes[j][0] - firstLoad), notes[j][1]);
+      if (buildId !== null)
+        return buildId;
+    }
+  } catch (e) {
+  }
+  return null;
+}
+
+function findBuildIdNote(start, size) {
+  var offset = 0;
+  while (offset + 12 <= size) {
+    var note = start.add(offset);
+    var nameSize = Memory.readU32(note);
+    var descSize = Memory.readU32(note.add(4));
+    var type = Memory.readU32(note.add(8));
+    var nameStart = 12;
+    var descStart = nameStart + align4(nameSize);
+    if (type === NT_GNU_BUILD_ID && nameSize === 4 &&
+        Memory.readUtf8String(note.add(nameStart), 3) === 'GNU') {
+      var hex = '';
+      for (var i = 0; i !== descSize; i++) {
+        var b = Memory.readU8(note.add(descStart + i));
+        hex += (b < 16 ? '0' : '') + b.toString(16);
+      }
+      return hex;
+    }
+    offset += descStart + align4(descSize);
+  }
+  return null;
+}
+
+function align4(n) {
+  return (n + 3) & ~3;
+}
+
+function collectModules() {
+  var columns = { names: [], sizes: [], paths: [], buildIds: [] };
+  var bases = [];
+  Process.enumerateModulesSync().forEach(function (m) {
+    columns.names.push(m.name);
+    columns.sizes.push(m.size);
+    columns.paths.push(m.path);
+    columns.buildIds.push(readBuildId(m.base));
+    bases.push(m.base);
+  });
+  return { columns: columns, bases: bases };
+}
+
+function createRangeColumns() {
+  var columns = { sizes: [], protections: [] };
+  var bases = [];
+  return {
+    columns: columns,
+    bases: bases,
+    add: function (r) {
+      bases.push(r.base);
+      columns.sizes.push(r.size);
+      columns.protections.push(r.protection);
+    },
+    finish: function () {
+      return [columns, packAddresses(bases)];
+    }
+  };
+}
+
+function packAddresses(addresses) {
+  var size = addresses.length * 8;
+  if (size === 0)
+    return null;
+  var column = Memory.alloc(size);
+  addresses.forEach(function (address, i) {
+    var slot = column.add(i * 8);
+    Memory.writeU64(slot, 0);
+    Memory.writePointer(slot, address);
+  });
+  return Memory.readByteArray(column, size);
+}
+
+function readU64AsNumber(address) {
+  return Memory.readU32(address.add(4)) * 4294967296 + Memory.readU32(address);
+}
+
+function notify(topic, payload, data) {
+  send({
+    name: 'notification',
+    topic: topic,
+    payload: payload
+  }, data || null);
+}
+
 function onStanza(stanza) {
   var handler = handlers[stanza.name];
   handler(stanza.payload)
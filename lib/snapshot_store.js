@@ -0,0 +1,166 @@
+'use strict';
+
+module.exports = SnapshotStore;
+
+
+var crypto = require('crypto');
+var fs = require('fs');
+var path = require('path');
+var known = Symbol('known');
+var loadIndex = Symbol('loadIndex');
+var objectPath = Symbol('objectPath');
+var manifestPath = Symbol('manifestPath');
+
+/*
+ * Content-addressed page store shared by any number of snapshots:
+ * `objects/ab/cdef...` holds each distinct page once, named by the hex
+ * SHA-256 digest of its contents, and `manifests/<name>.json` lists the
+ * digests making up each snapshotted range.
+ */
+function SnapshotStore(directory) {
+  Object.defineProperty(this, 'directory', {
+    enumerable: true,
+    value: directory
+  });
+
+  this[known] = null;
+}
+
+SnapshotStore.digest = function (data) {
+  return crypto.createHash('sha256').update(data).digest('hex');
+};
+
+/*
+ * Resolves to the distinct digests among `digests` not yet stored.
+ */
+SnapshotStore.prototype.missing = function (digests) {
+  return this[loadIndex]().then(function (index) {
+    var seen = {};
+    return digests.filter(function (digest) {
+      if (index.has(digest) || seen[digest])
+        return false;
+      seen[digest] = true;
+      return true;
+    });
+  });
+};
+
+/*
+ * Stores a page, writing it under a temporary name first so that readers
+ * never see a partial object. Data that does not match `digest` is
+ * rejected instead of being stored under the wrong name.
+ */
+SnapshotStore.prototype.writeObject = function (digest, data) {
+  var target = this[objectPath](digest);
+  var temporary = target + '.' + process.pid + '.tmp';
+  return this[loadIndex]()
+  .then(function () {
+    if (SnapshotStore.digest(data) !== digest)
+      throw new Error('Object does not match its digest ' + digest);
+    return makeDirectory(path.dirname(target));
+  })
+  .then(function () {
+    return call(fs.writeFile, temporary, data);
+  })
+  .then(function () {
+    return call(fs.rename, temporary, target);
+  })
+  .then(function () {
+    this[known].add(digest);
+  }.bind(this));
+};
+
+SnapshotStore.prototype.readObject = function (digest) {
+  return call(fs.readFile, this[objectPath](digest));
+};
+
+SnapshotStore.prototype.writeManifest = function (name, manifest) {
+  var target = this[manifestPath](name);
+  return makeDirectory(path.dirname(target))
+  .then(function () {
+    return call(fs.writeFile, target, JSON.stringify(manifest));
+  });
+};
+
+SnapshotStore.prototype.readManifest = function (name) {
+  return call(fs.readFile, this[manifestPath](name), { encoding: 'utf-8' })
+  .then(JSON.parse);
+};
+
+/*
+ * Lists the stored digests once; after that the index is kept up to date
+ * by writeObject(). Objects added by other processes in the meantime are
+ * merely transferred and written again.
+ */
+SnapshotStore.prototype[loadIndex] = function () {
+  if (this[known] !== null)
+    return Promise.resolve(this[known]);
+
+  var objects = path.join(this.directory, 'objects');
+  return makeDirectory(objects)
+  .then(function () {
+    return call(fs.readdir, objects);
+  })
+  .then(function (prefixes) {
+    return Promise.all(prefixes.map(function (prefix) {
+      return call(fs.readdir, path.join(objects, prefix))
+      .then(function (names) {
+        return names.filter(function (name) {
+          return name.indexOf('.') === -1;
+        }).map(function (name) {
+          return prefix + name;
+        });
+      }, function () {
+        return [];
+      });
+    }));
+  })
+  .then(function (lists) {
+    if (this[known] === null) {
+      this[known] = new Set();
+      lists.forEach(function (list) {
+        list.forEach(this[known].add, this[known]);
+      }, this);
+    }
+    return this[known];
+  }.bind(this));
+};
+
+SnapshotStore.prototype[objectPath] = function (digest) {
+  return path.join(this.directory, 'objects', digest.substr(0, 2),
+      digest.substr(2));
+};
+
+SnapshotStore.prototype[manifestPath] = function (name) {
+  return path.join(this.directory, 'manifests', name + '.json');
+};
+
+function makeDirectory(directory) {
+  return new Promise(function (resolve, reject) {
+    fs.mkdir(directory, function (err) {
+      if (!err || err.code === 'EEXIST') {
+        resolve();
+      } else if (err.code === 'ENOENT') {
+        makeDirectory(path.dirname(directory))
+        .then(function () {
+          return makeDirectory(directory);
+        })
+        .then(resolve, reject);
+      } else {
+        reject(err);
+      }
+    });
+  });
+}
+
+function call(fn) {
+  var args = Array.prototype.slice.call(arguments, 1);
+  return new Promise(function (resolve, reject) {
+    fn.apply(fs, args.concat(function (err, result) {
+      if (err)
+        reject(err);
+      else
+        resolve(result);
+    }));
+  });
+}
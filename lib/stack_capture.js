@@ -0,0 +1,82 @@
+'use strict';
+
+exports.DEFAULT_STACK_SIZE = 16 * 1024;
+
+exports.install = install;
+
+
+var agentShim = require('./agent_shim');
+
+/*
+ * Prepends an agent-side captureStack(context[, size]) that returns the
+ * registers and up to `size` bytes above sp as one ArrayBuffer, ready to be
+ * sent as message data and unwound with Session#unwind(). Only x86-64 is
+ * supported; elsewhere captureStack() throws.
+ */
+function install(source, options) {
+  var size = (options && typeof options.size === 'number')
+      ? options.size
+      : exports.DEFAULT_STACK_SIZE;
+  return agentShim.prepend(source, installStackCapture, [size]);
+}
+
+/* jshint ignore:start */
+function installStackCapture(defaultSize) {
+  var global = Function('return this')();
+  var MAGIC = 0x4b545346;
+  var ARCH_X64 = 1;
+  var HEADER_SIZE = 160;
+  var REGISTERS = ['rax', 'rdx', 'rcx', 'rbx', 'rsi', 'rdi', 'rbp', 'rsp',
+      'r8', 'r9', 'r10', 'r11', 'r12', 'r13', 'r14', 'r15', 'rip'];
+  var scratch = null;
+  var scratchSize = 0;
+  var lastRange = null;
+
+  function findStackEnd(sp) {
+    if (lastRange === null || sp.compare(lastRange.base) < 0 ||
+        sp.compare(lastRange.base.add(lastRange.size)) >= 0) {
+      lastRange = (typeof Process.findRangeByAddress === 'function')
+          ? Process.findRangeByAddress(sp)
+          : null;
+    }
+    return (lastRange !== null) ? lastRange.base.add(lastRange.size) : null;
+  }
+
+  global.captureStack = function (context, size) {
+    if (Process.arch !== 'x64') {
+      throw new Error('captureStack() is only supported on x86-64');
+    }
+    size = (size === undefined) ? defaultSize : size;
+
+    var sp = context.rsp;
+    var end = findStackEnd(sp);
+    if (end !== null) {
+      size = Math.min(size, parseInt(end.sub(sp).toString(), 16));
+    }
+
+    if (scratch === null || scratchSize < HEADER_SIZE + size) {
+      scratchSize = HEADER_SIZE + size;
+      scratch = Memory.alloc(scratchSize);
+    }
+
+    Memory.writeU32(scratch, MAGIC);
+    Memory.writeU32(scratch.add(4), ARCH_X64);
+    REGISTERS.forEach(function (name, i) {
+      Memory.writePointer(scratch.add(8 + i * 8), context[name]);
+    });
+    Memory.writePointer(scratch.add(144), sp);
+    Memory.writeU32(scratch.add(152), size);
+    Memory.writeU32(scratch.add(156), 0);
+
+    if (typeof Memory.copy === 'function') {
+      Memory.copy(scratch.add(HEADER_SIZE), sp, size);
+      return Memory.readByteArray(scratch, HEADER_SIZE + size);
+    }
+
+    var blob = new Uint8Array(HEADER_SIZE + size);
+    blob.set(new Uint8Array(Memory.readByteArray(scratch, HEADER_SIZE)), 0);
+    blob.set(new Uint8Array(Memory.readByteArray(sp, size)), HEADER_SIZE);
+    return blob.buffer;
+  };
+}
+/* jshint ignore:end */
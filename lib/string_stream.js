@@ -0,0 +1,160 @@
+'use strict';
+
+module.exports = StringStream;
+
+
+var binding = require('bindings')('frida_binding');
+var ptr = require('./ptr');
+var Readable = require('stream').Readable;
+var util = require('util');
+var request = Symbol('request');
+var ranges = Symbol('ranges');
+var rangeIndex = Symbol('rangeIndex');
+var cursor = Symbol('cursor');
+var minLength = Symbol('minLength');
+var encodingMask = Symbol('encodingMask');
+var chunkSize = Symbol('chunkSize');
+var busy = Symbol('busy');
+var pump = Symbol('pump');
+var nextChunk = Symbol('nextChunk');
+
+var DEFAULT_CHUNK_SIZE = 4 * 1024 * 1024;
+var MIN_CHUNK_SIZE = 64;
+var DEFAULT_MIN_LENGTH = 4;
+var ENCODINGS = {
+  ascii: 1,
+  utf16le: 2
+};
+var ENCODING_NAMES = {
+  1: 'ascii',
+  2: 'utf16le'
+};
+
+/*
+ * Object-mode Readable of { address, encoding, string } for each run of at
+ * least `minLength` printable characters in `ranges`. Memory is read in
+ * chunks of `chunkSize` bytes, at least 64, and scanned on the threadpool
+ * one chunk at a time, as the consumer asks for more. Runs longer than a
+ * chunk come out split; unreadable chunks are skipped.
+ */
+function StringStream(session, sessionRequest, rangesPromise, options) {
+  options = options || {};
+
+  var encodings = options.encodings || ['ascii', 'utf16le'];
+  var mask = 0;
+  encodings.forEach(function (name) {
+    if (!ENCODINGS.hasOwnProperty(name))
+      throw new Error('Unsupported encoding: ' + name);
+    mask |= ENCODINGS[name];
+  });
+
+  Readable.call(this, {
+    objectMode: true,
+    highWaterMark: options.highWaterMark
+  });
+
+  Object.defineProperty(this, request, {
+    value: session[sessionRequest].bind(session)
+  });
+
+  this[ranges] = rangesPromise;
+  this[rangeIndex] = 0;
+  this[cursor] = null;
+  this[minLength] = options.minLength || DEFAULT_MIN_LENGTH;
+  this[encodingMask] = mask;
+  this[chunkSize] = Math.max(options.chunkSize || DEFAULT_CHUNK_SIZE,
+      MIN_CHUNK_SIZE);
+  this[busy] = false;
+}
+
+util.inherits(StringStream, Readable);
+
+StringStream.prototype._read = function () {
+  if (this[busy])
+    return;
+  this[busy] = true;
+  this[ranges]
+  .then(function (list) {
+    return this[pump](list);
+  }.bind(this))
+  .catch(function (error) {
+    this.emit('error', error);
+  }.bind(this));
+};
+
+/*
+ * Scans chunks until one of them yields strings or the ranges run out.
+ */
+StringStream.prototype[pump] = function (list) {
+  var chunk = this[nextChunk](list);
+  if (chunk === null) {
+    this[busy] = false;
+    this.push(null);
+    return null;
+  }
+
+  return this[request]('memory:read-byte-array', {
+    address: chunk.address.toString(),
+    size: chunk.size
+  })
+  .then(function (result) {
+    return result[1];
+  }, function () {
+    return null;
+  })
+  .then(function (data) {
+    if (data === null) {
+      this[cursor] = chunk.address.add(chunk.size);
+      return [];
+    }
+    return binding.extractStrings(data, this[minLength], this[encodingMask],
+        chunk.final)
+    .then(function (packed) {
+      var resume = packed.readUInt32LE(0);
+      this[cursor] = chunk.address.add(resume);
+      var strings = [];
+      for (var offset = 4; offset !== packed.length; offset += 12) {
+        var start = packed.readUInt32LE(offset);
+        var size = packed.readUInt32LE(offset + 4);
+        var encoding = ENCODING_NAMES[packed.readUInt32LE(offset + 8)];
+        strings.push({
+          address: chunk.address.add(start),
+          encoding: encoding,
+          string: data.toString(encoding, start, start + size)
+        });
+      }
+      return strings;
+    }.bind(this));
+  }.bind(this))
+  .then(function (strings) {
+    if (strings.length === 0)
+      return this[pump](list);
+    this[busy] = false;
+    strings.forEach(function (s) {
+      this.push(s);
+    }, this);
+    return null;
+  }.bind(this));
+};
+
+StringStream.prototype[nextChunk] = function (list) {
+  while (this[rangeIndex] !== list.length) {
+    var range = list[this[rangeIndex]];
+    var base = ptr(range.baseAddress.toString());
+    var end = base.add(range.size);
+    if (this[cursor] === null)
+      this[cursor] = base;
+    var remaining = end.subtract(this[cursor]).toJSNumber();
+    if (remaining > 0) {
+      var size = Math.min(this[chunkSize], remaining);
+      return {
+        address: this[cursor],
+        size: size,
+        final: size === remaining
+      };
+    }
+    this[rangeIndex]++;
+    this[cursor] = null;
+  }
+  return null;
+};
@@ -0,0 +1,81 @@
+'use strict';
+
+module.exports = Symbolicator;
+
+
+var AddressMap = require('./address_map');
+var ModuleMap = require('./module_map');
+var session = Symbol('session');
+var moduleMapPromise = Symbol('moduleMapPromise');
+var exportMaps = Symbol('exportMaps');
+var getExportMap = Symbol('getExportMap');
+
+/*
+ * Resolves addresses to module!export+offset using the session's module
+ * index, treating each export as extending up to the next one.
+ */
+function Symbolicator(s) {
+  this[session] = s;
+  this[moduleMapPromise] = null;
+  this[exportMaps] = {};
+}
+
+Symbolicator.prototype.symbolicate = function (addresses) {
+  if (this[moduleMapPromise] === null) {
+    this[moduleMapPromise] = this[session].enumerateModules()
+    .then(function (modules) {
+      return new ModuleMap(modules);
+    });
+  }
+
+  return this[moduleMapPromise].then(function (moduleMap) {
+    return Promise.all(addresses.map(function (address) {
+      var m = moduleMap.lookup(address);
+      if (m === null) {
+        return {
+          address: address,
+          module: null,
+          symbol: null,
+          name: '0x' + address.toString(16)
+        };
+      }
+
+      return this[getExportMap](m).then(function (exportMap) {
+        var e = exportMap.lookup(address);
+        var symbol = null;
+        var name;
+        if (e !== null) {
+          symbol = e.name;
+          name = m.name + '!' + e.name;
+          var offset = address.subtract(e.absoluteAddress);
+          if (!offset.isZero())
+            name += '+0x' + offset.toString(16);
+        } else {
+          name = m.name + '+0x' + address.subtract(m.baseAddress).toString(16);
+        }
+        return {
+          address: address,
+          module: m.name,
+          symbol: symbol,
+          name: name
+        };
+      });
+    }, this));
+  }.bind(this));
+};
+
+Symbolicator.prototype[getExportMap] = function (m) {
+  var exportMap = this[exportMaps][m.path];
+  if (exportMap === undefined) {
+    var end = m.baseAddress.add(m.size);
+    exportMap = m.enumerateExports().then(function (exports) {
+      return new AddressMap(exports, function (e) {
+        return e.absoluteAddress;
+      }, function (e) {
+        return end.subtract(e.absoluteAddress);
+      });
+    });
+    this[exportMaps][m.path] = exportMap;
+  }
+  return exportMap;
+};
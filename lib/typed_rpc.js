@@ -0,0 +1,192 @@
+'use strict';
+
+exports.install = install;
+
+
+var agentShim = require('./agent_shim');
+
+var TYPED_RPC_TAG = 'frida:rpc-typed';
+
+exports.TAG = TYPED_RPC_TAG;
+
+/*
+ * Prepends an agent-side shim that serves typed calls to exports listed in
+ * rpc.signatures, e.g. rpc.signatures = { add: '(i32, i32) -> i32' }.
+ * Arguments arrive as a binary frame and results leave as the reply's
+ * data, so neither side goes through JSON for numbers and buffers.
+ */
+function install(source) {
+  return agentShim.prepend(source, installTypedRpc, [TYPED_RPC_TAG],
+      [agentShim.decodeBase64]);
+}
+
+/* jshint ignore:start */
+function installTypedRpc(tag) {
+  var global = Function('return this')();
+  var SIZES = {
+    'void': 0, 'bool': 1, 'i8': 1, 'u8': 1, 'i16': 2, 'u16': 2, 'i32': 4,
+    'u32': 4, 'f32': 4, 'f64': 8, 'i64': 8, 'u64': 8, 'string': 0,
+    'buffer': 4
+  };
+  var parsed = {};
+
+  function parse(spec) {
+    var match = /^\s*\(([^)]*)\)\s*(?:->\s*(\w+)\s*)?$/.exec(spec);
+    if (match === null) {
+      throw new Error('Invalid RPC signature: ' + spec);
+    }
+    var args = (match[1].trim() !== '') ? match[1].split(',').map(function (type) {
+      return type.trim();
+    }) : [];
+    return { args: args, ret: match[2] || 'void' };
+  }
+
+  function signatureOf(name) {
+    var spec = (global.rpc.signatures || {})[name];
+    if (spec === undefined) {
+      throw new Error('No signature declared for ' + name);
+    }
+    var entry = parsed[name];
+    if (entry === undefined || entry.spec !== spec) {
+      entry = { spec: spec, signature: parse(spec) };
+      parsed[name] = entry;
+    }
+    return entry.signature;
+  }
+
+  function read64(view, offset, signed) {
+    var low = view.getUint32(offset, true);
+    var high = signed ? view.getInt32(offset + 4, true) : view.getUint32(offset + 4, true);
+    if (high >= -0x200000 && high < 0x200000) {
+      return high * 4294967296 + low;
+    }
+    if (!signed) {
+      return global.uint64('0x' + toHex64(high, low));
+    }
+    if (high >= 0) {
+      return global.int64('0x' + toHex64(high, low));
+    }
+    low = (~low + 1) >>> 0;
+    high = (~high + ((low === 0) ? 1 : 0)) >>> 0;
+    return global.int64('-0x' + toHex64(high, low));
+  }
+
+  function toHex64(high, low) {
+    var hex = '0000000' + low.toString(16);
+    return high.toString(16) + hex.substring(hex.length - 8);
+  }
+
+  function split64(value) {
+    if (typeof value === 'number') {
+      var high = Math.floor(value / 4294967296);
+      return [value - high * 4294967296, high >>> 0];
+    }
+    var hex = value.toString(16);
+    var negative = hex[0] === '-';
+    if (negative) {
+      hex = hex.substring(1);
+    }
+    var low = parseInt(hex.substring(Math.max(0, hex.length - 8)), 16);
+    var high = (hex.length > 8) ? parseInt(hex.substring(0, hex.length - 8), 16) : 0;
+    if (negative) {
+      low = (~low + 1) >>> 0;
+      high = (~high + ((low === 0) ? 1 : 0)) >>> 0;
+    }
+    return [low, high];
+  }
+
+  function readArguments(signature, frame, strings) {
+    var bytes = decodeBase64(frame);
+    var view = new DataView(bytes.buffer);
+    var offset = 0;
+    var nextString = 0;
+    return signature.args.map(function (type) {
+      var value;
+      switch (type) {
+        case 'bool': value = view.getUint8(offset) !== 0; break;
+        case 'i8': value = view.getInt8(offset); break;
+        case 'u8': value = view.getUint8(offset); break;
+        case 'i16': value = view.getInt16(offset, true); break;
+        case 'u16': value = view.getUint16(offset, true); break;
+        case 'i32': value = view.getInt32(offset, true); break;
+        case 'u32': value = view.getUint32(offset, true); break;
+        case 'f32': value = view.getFloat32(offset, true); break;
+        case 'f64': value = view.getFloat64(offset, true); break;
+        case 'i64': value = read64(view, offset, true); break;
+        case 'u64': value = read64(view, offset, false); break;
+        case 'string': value = strings[nextString++]; break;
+        case 'buffer':
+          var length = view.getUint32(offset, true);
+          value = new Uint8Array(bytes.subarray(offset + 4, offset + 4 + length)).buffer;
+          offset += length;
+          break;
+      }
+      offset += SIZES[type];
+      return value;
+    });
+  }
+
+  function encodeResult(type, value) {
+    switch (type) {
+      case 'void': return [null, null];
+      case 'string': return [value, null];
+      case 'buffer': return [null, value];
+    }
+    var data = new ArrayBuffer(SIZES[type]);
+    var view = new DataView(data);
+    switch (type) {
+      case 'bool': view.setUint8(0, value ? 1 : 0); break;
+      case 'i8': view.setInt8(0, value); break;
+      case 'u8': view.setUint8(0, value); break;
+      case 'i16': view.setInt16(0, value, true); break;
+      case 'u16': view.setUint16(0, value, true); break;
+      case 'i32': view.setInt32(0, value, true); break;
+      case 'u32': view.setUint32(0, value, true); break;
+      case 'f32': view.setFloat32(0, value, true); break;
+      case 'f64': view.setFloat64(0, value, true); break;
+      case 'i64':
+      case 'u64':
+        var parts = split64(value);
+        view.setUint32(0, parts[0], true);
+        view.setUint32(4, parts[1], true);
+        break;
+    }
+    return [null, data];
+  }
+
+  function onRequest(message) {
+    recv(tag, onRequest);
+
+    var id = message.id;
+    var fail = function (error) {
+      send(['frida:rpc', id, 'error', error.message]);
+    };
+    try {
+      var exports = global.rpc.exports;
+      if (message.op === 'describe') {
+        send(['frida:rpc', id, 'ok', {
+          names: Object.getOwnPropertyNames(exports),
+          signatures: global.rpc.signatures || {}
+        }]);
+        return;
+      }
+
+      var signature = signatureOf(message.name);
+      var result = exports[message.name].apply(exports,
+          readArguments(signature, message.frame, message.strings));
+      var reply = function (value) {
+        var encoded = encodeResult(signature.ret, value);
+        send(['frida:rpc', id, 'ok', encoded[0]], encoded[1]);
+      };
+      if (result !== null && typeof result === 'object' && typeof result.then === 'function') {
+        result.then(reply, fail);
+      } else {
+        reply(result);
+      }
+    } catch (e) {
+      fail(e);
+    }
+  }
+  recv(tag, onRequest);
+}
+/* jshint ignore:end */
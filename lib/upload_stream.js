@@ -0,0 +1,168 @@
+'use strict';
+
+module.exports = UploadStream;
+
+
+var ptr = require('./ptr');
+var util = require('util');
+var Writable = require('stream').Writable;
+var request = Symbol('request');
+var cursor = Symbol('cursor');
+var limit = Symbol('limit');
+var chunkSize = Symbol('chunkSize');
+var windowSize = Symbol('windowSize');
+var inFlight = Symbol('inFlight');
+var resume = Symbol('resume');
+var finish = Symbol('finish');
+var ending = Symbol('ending');
+var failure = Symbol('failure');
+var sendChunk = Symbol('sendChunk');
+var onAck = Symbol('onAck');
+
+var DEFAULT_CHUNK_SIZE = 64 * 1024;
+var DEFAULT_WINDOW = 4;
+
+/*
+ * Writable that streams bytes into target memory starting at `address`.
+ * Up to `window` chunks are in flight at once, each acknowledged by the
+ * agent once written; beyond that, _write() holds back its callback so
+ * regular stream backpressure bounds what's buffered on the host.
+ */
+function UploadStream(session, sessionRequest, address, options) {
+  options = options || {};
+  var size = options.chunkSize || DEFAULT_CHUNK_SIZE;
+  var window = options.window || DEFAULT_WINDOW;
+
+  Writable.call(this, {
+    highWaterMark: options.highWaterMark || size * window
+  });
+
+  Object.defineProperty(this, request, {
+    value: session[sessionRequest].bind(session)
+  });
+
+  var start = ptr(address.toString());
+  Object.defineProperty(this, 'address', {
+    enumerable: true,
+    value: start
+  });
+
+  this.bytesWritten = 0;
+
+  this[cursor] = start;
+  this[limit] = (options.size !== undefined) ? options.size : null;
+  this[chunkSize] = size;
+  this[windowSize] = window;
+  this[inFlight] = 0;
+  this[resume] = null;
+  this[finish] = null;
+  this[ending] = false;
+  this[failure] = null;
+}
+
+util.inherits(UploadStream, Writable);
+
+UploadStream.prototype._write = function (chunk, encoding, callback) {
+  if (this[limit] !== null &&
+      this.bytesWritten + chunk.length > this[limit]) {
+    callback(new Error('Upload exceeds the target size of ' + this[limit] +
+        ' bytes'));
+    return;
+  }
+
+  var size = this[chunkSize];
+  var offset = 0;
+
+  var next = function () {
+    if (this[failure] !== null) {
+      callback(this[failure]);
+      return;
+    }
+    while (offset < chunk.length && this[inFlight] < this[windowSize]) {
+      this[sendChunk](chunk.slice(offset, offset + size));
+      offset += size;
+    }
+    if (offset < chunk.length || this[inFlight] >= this[windowSize])
+      this[resume] = next;
+    else
+      callback();
+  }.bind(this);
+
+  next();
+};
+
+/*
+ * 'finish' must not fire while chunks are still in flight, and Writable
+ * only learned to wait for that through _final() in Node 8. So end() is
+ * held back until the last write has been handed to _write() and every
+ * chunk has been acknowledged.
+ */
+UploadStream.prototype.end = function (chunk, encoding, callback) {
+  if (typeof chunk === 'function') {
+    callback = chunk;
+    chunk = null;
+    encoding = null;
+  } else if (typeof encoding === 'function') {
+    callback = encoding;
+    encoding = null;
+  }
+
+  if (this[ending]) {
+    if (typeof callback === 'function')
+      this.once('finish', callback);
+    return this;
+  }
+  this[ending] = true;
+
+  var last = (chunk !== null && chunk !== undefined) ? chunk : new Buffer(0);
+  this.write(last, encoding, function (error) {
+    if (error)
+      return;
+    var done = function (error) {
+      if (error !== null)
+        this.emit('error', error);
+      else
+        Writable.prototype.end.call(this, callback);
+    }.bind(this);
+    if (this[inFlight] === 0)
+      done(this[failure]);
+    else
+      this[finish] = done;
+  }.bind(this));
+  return this;
+};
+
+UploadStream.prototype[sendChunk] = function (piece) {
+  var address = this[cursor];
+  this[cursor] = address.add(piece.length);
+  this.bytesWritten += piece.length;
+  this[inFlight]++;
+
+  this[request]('memory:write-batch', {
+    data: piece.toString('base64'),
+    writes: [['0x' + address.toString(16), 0, piece.length]]
+  })
+  .then(function () {
+    this[onAck](null);
+  }.bind(this), function (error) {
+    this[onAck](error);
+  }.bind(this));
+};
+
+UploadStream.prototype[onAck] = function (error) {
+  this[inFlight]--;
+  if (error !== null && this[failure] === null)
+    this[failure] = error;
+
+  var pending = this[resume];
+  if (pending !== null) {
+    this[resume] = null;
+    pending();
+  }
+
+  if (this[inFlight] === 0 && this[finish] !== null) {
+    var callback = this[finish];
+    this[finish] = null;
+    callback(this[failure]);
+  }
+};
@@ -2,13 +2,22 @@
 #include "device.h"
 #include "device_manager.h"
 #include "events.h"
+#include "frontmost_watcher.h"
 #include "glib_context.h"
+#include "heap_walker.h"
 #include "icon.h"
+#include "idle_watcher.h"
+#include "message_filter.h"
 #include "process.h"
+#include "reference_scanner.h"
 #include "runtime.h"
 #include "script.h"
 #include "session.h"
 #include "spawn.h"
+#include "string_scanner.h"
+#ifdef HAVE_UNWINDER
+# include "unwinder.h"
+#endif
 #include "uv_context.h"
 
 #include <node.h>
@@ -32,6 +41,8 @@ static void InitAll(Handle<Object> exports,
   auto runtime = new Runtime(uv_context, glib_context);
 
   Events::Init(exports, runtime);
+  MessageFilter::Init(exports, runtime);
+  IdleWatcher::Init(exports, runtime);
 
   DeviceManager::Init(exports, runtime);
   Device::Init(exports, runtime);
@@ -39,9 +50,17 @@ static void InitAll(Handle<Object> exports,
   Process::Init(exports, runtime);
   Spawn::Init(exports, runtime);
   Icon::Init(exports, runtime);
+  FrontmostWatcher::Init(exports, runtime);
   Session::Init(exports, runtime);
   Script::Init(exports, runtime);
 
+#ifdef HAVE_UNWINDER
+  Unwinder::Init(exports, runtime);
+#endif
+  HeapWalker::Init(exports, runtime);
+  ReferenceScanner::Init(exports, runtime);
+  StringScanner::Init(exports, runtime);
+
   node::AtExit(DisposeAll, runtime);
 }
 
@@ -26,6 +26,8 @@ Application::Application(FridaApplication* handle, Runtime* runtime)
 }
 
 Application::~Application() {
+  large_icon_.Reset();
+  small_icon_.Reset();
   g_object_unref(handle_);
 }
 
@@ -65,6 +67,32 @@ Local<Object> Application::New(gpointer handle, Runtime* runtime) {
   return Nan::NewInstance(ctor, argc, argv).ToLocalChecked();
 }
 
+Local<Object> Application::NewSummary(gpointer handle) {
+  auto isolate = Isolate::GetCurrent();
+  auto application = static_cast<FridaApplication*>(handle);
+
+  auto summary = Nan::New<v8::Object>();
+  Nan::Set(summary, Nan::New("identifier").ToLocalChecked(),
+      Nan::New(frida_application_get_identifier(application))
+      .ToLocalChecked());
+  Nan::Set(summary, Nan::New("name").ToLocalChecked(),
+      Nan::New(frida_application_get_name(application)).ToLocalChecked());
+  Nan::Set(summary, Nan::New("pid").ToLocalChecked(),
+      Integer::NewFromUnsigned(isolate,
+        frida_application_get_pid(application)));
+  return summary;
+}
+
+void Application::LoadIcons(Local<Object> application) {
+  auto wrapper = ObjectWrap::Unwrap<Application>(application);
+  auto handle = wrapper->GetHandle<FridaApplication>();
+
+  Icon::Load(Icon::NewCached(&wrapper->small_icon_,
+      frida_application_get_small_icon(handle), wrapper->runtime_));
+  Icon::Load(Icon::NewCached(&wrapper->large_icon_,
+      frida_application_get_large_icon(handle), wrapper->runtime_));
+}
+
 NAN_METHOD(Application::New) {
   if (info.IsConstructCall()) {
     if (info.Length() != 1 || !info[0]->IsExternal()) {
@@ -114,16 +142,16 @@ NAN_PROPERTY_GETTER(Application::GetSmallIcon) {
   auto wrapper = ObjectWrap::Unwrap<Application>(info.Holder());
   auto handle = wrapper->GetHandle<FridaApplication>();
 
-  info.GetReturnValue().Set(
-      Icon::New(frida_application_get_small_icon(handle), wrapper->runtime_));
+  info.GetReturnValue().Set(Icon::NewCached(&wrapper->small_icon_,
+      frida_application_get_small_icon(handle), wrapper->runtime_));
 }
 
 NAN_PROPERTY_GETTER(Application::GetLargeIcon) {
   auto wrapper = ObjectWrap::Unwrap<Application>(info.Holder());
   auto handle = wrapper->GetHandle<FridaApplication>();
 
-  info.GetReturnValue().Set(
-      Icon::New(frida_application_get_large_icon(handle), wrapper->runtime_));
+  info.GetReturnValue().Set(Icon::NewCached(&wrapper->large_icon_,
+      frida_application_get_large_icon(handle), wrapper->runtime_));
 }
 
 }
@@ -12,6 +12,8 @@ class Application : public GLibObject {
  public:
   static void Init(v8::Handle<v8::Object> exports, Runtime* runtime);
   static v8::Local<v8::Object> New(gpointer handle, Runtime* runtime);
+  static v8::Local<v8::Object> NewSummary(gpointer handle);
+  static void LoadIcons(v8::Local<v8::Object> application);
 
  private:
   explicit Application(FridaApplication* handle, Runtime* runtime);
@@ -24,6 +26,9 @@ class Application : public GLibObject {
   static NAN_PROPERTY_GETTER(GetPid);
   static NAN_PROPERTY_GETTER(GetSmallIcon);
   static NAN_PROPERTY_GETTER(GetLargeIcon);
+
+  v8::Persistent<v8::Value> small_icon_;
+  v8::Persistent<v8::Value> large_icon_;
 };
 
 }
@@ -2,12 +2,14 @@
 
 #include "application.h"
 #include "events.h"
+#include "frontmost_watcher.h"
 #include "icon.h"
 #include "operation.h"
 #include "process.h"
 #include "session.h"
 #include "spawn.h"
 
+#include <cstring>
 #include <nan.h>
 #include <node.h>
 
@@ -27,6 +29,15 @@ using v8::Value;
 
 namespace frida {
 
+enum EnumerationScope {
+  SCOPE_MINIMAL,
+  SCOPE_METADATA,
+  SCOPE_FULL
+};
+
+static bool ParseEnumerationScope(const Nan::FunctionCallbackInfo<Value>& info,
+    EnumerationScope* scope);
+
 Device::Device(FridaDevice* handle, Runtime* runtime)
     : GLibObject(handle, runtime) {
   g_object_ref(handle_);
@@ -57,6 +68,8 @@ void Device::Init(Handle<Object> exports, Runtime* runtime) {
 
   Nan::SetPrototypeMethod(tpl, "getFrontmostApplication",
       GetFrontmostApplication);
+  Nan::SetPrototypeMethod(tpl, "watchFrontmostApplication",
+      WatchFrontmostApplication);
   Nan::SetPrototypeMethod(tpl, "enumerateApplications", EnumerateApplications);
   Nan::SetPrototypeMethod(tpl, "enumerateProcesses", EnumerateProcesses);
   Nan::SetPrototypeMethod(tpl, "enableSpawnGating", EnableSpawnGating);
@@ -101,8 +114,8 @@ NAN_METHOD(Device::New) {
     Nan::Set(obj, Nan::New("events").ToLocalChecked(), events_obj);
 
     auto events_wrapper = ObjectWrap::Unwrap<Events>(events_obj);
-    events_wrapper->SetListenCallback(OnListen, wrapper);
-    events_wrapper->SetUnlistenCallback(OnUnlisten, wrapper);
+    events_wrapper->SetListenCallback(OnListen, runtime);
+    events_wrapper->SetUnlistenCallback(OnUnlisten, runtime);
 
     info.GetReturnValue().Set(obj);
   } else {
@@ -177,6 +190,11 @@ class GetFrontmostApplicationOperation : public Operation<FridaDevice> {
     }
   }
 
+  void Discard() {
+    if (application_ != NULL)
+      g_object_unref(application_);
+  }
+
   FridaApplication* application_;
 };
 
@@ -191,8 +209,29 @@ NAN_METHOD(Device::GetFrontmostApplication) {
   info.GetReturnValue().Set(operation->GetPromise(isolate));
 }
 
+NAN_METHOD(Device::WatchFrontmostApplication) {
+  auto wrapper = ObjectWrap::Unwrap<Device>(info.Holder());
+
+  if (info.Length() < 2 || !info[0]->IsFunction() || !info[1]->IsNumber()) {
+    Nan::ThrowTypeError("Bad argument, expected callback and interval");
+    return;
+  }
+  auto callback = Local<Function>::Cast(info[0]);
+  auto interval = info[1]->Uint32Value();
+  if (interval == 0) {
+    Nan::ThrowTypeError("Bad argument, interval must be positive");
+    return;
+  }
+
+  info.GetReturnValue().Set(FrontmostWatcher::New(wrapper->handle_, interval,
+      callback, wrapper->runtime_));
+}
+
 class EnumerateApplicationsOperation : public Operation<FridaDevice> {
  public:
+  EnumerateApplicationsOperation(EnumerationScope scope) : scope_(scope) {
+  }
+
   void Begin() {
     frida_device_enumerate_applications(handle_, OnReady, this);
   }
@@ -207,7 +246,14 @@ class EnumerateApplicationsOperation : public Operation<FridaDevice> {
     auto applications = Nan::New<v8::Array>(size);
     for (auto i = 0; i != size; i++) {
       auto handle = frida_application_list_get(applications_, i);
-      auto application = Application::New(handle, runtime_);
+      Local<Object> application;
+      if (scope_ == SCOPE_MINIMAL) {
+        application = Application::NewSummary(handle);
+      } else {
+        application = Application::New(handle, runtime_);
+        if (scope_ == SCOPE_FULL)
+          Application::LoadIcons(application);
+      }
       Nan::Set(applications, i, application);
       g_object_unref(handle);
     }
@@ -217,6 +263,11 @@ class EnumerateApplicationsOperation : public Operation<FridaDevice> {
     return applications;
   }
 
+  void Discard() {
+    g_object_unref(applications_);
+  }
+
+  const EnumerationScope scope_;
   FridaApplicationList* applications_;
 };
 
@@ -225,7 +276,11 @@ NAN_METHOD(Device::EnumerateApplications) {
   auto obj = info.Holder();
   auto wrapper = ObjectWrap::Unwrap<Device>(obj);
 
-  auto operation = new EnumerateApplicationsOperation();
+  EnumerationScope scope;
+  if (!ParseEnumerationScope(info, &scope))
+    return;
+
+  auto operation = new EnumerateApplicationsOperation(scope);
   operation->Schedule(isolate, wrapper);
 
   info.GetReturnValue().Set(operation->GetPromise(isolate));
@@ -233,6 +288,9 @@ NAN_METHOD(Device::EnumerateApplications) {
 
 class EnumerateProcessesOperation : public Operation<FridaDevice> {
  public:
+  EnumerateProcessesOperation(EnumerationScope scope) : scope_(scope) {
+  }
+
   void Begin() {
     frida_device_enumerate_processes(handle_, OnReady, this);
   }
@@ -247,7 +305,14 @@ class EnumerateProcessesOperation : public Operation<FridaDevice> {
     auto processes = Nan::New<v8::Array>(size);
     for (auto i = 0; i != size; i++) {
       auto handle = frida_process_list_get(processes_, i);
-      auto process = Process::New(handle, runtime_);
+      Local<Object> process;
+      if (scope_ == SCOPE_MINIMAL) {
+        process = Process::NewSummary(handle);
+      } else {
+        process = Process::New(handle, runtime_);
+        if (scope_ == SCOPE_FULL)
+          Process::LoadIcons(process);
+      }
       Nan::Set(processes, i, process);
       g_object_unref(handle);
     }
@@ -257,6 +322,11 @@ class EnumerateProcessesOperation : public Operation<FridaDevice> {
     return processes;
   }
 
+  void Discard() {
+    g_object_unref(processes_);
+  }
+
+  const EnumerationScope scope_;
   FridaProcessList* processes_;
 };
 
@@ -265,7 +335,11 @@ NAN_METHOD(Device::EnumerateProcesses) {
   auto obj = info.Holder();
   auto wrapper = ObjectWrap::Unwrap<Device>(obj);
 
-  auto operation = new EnumerateProcessesOperation();
+  EnumerationScope scope;
+  if (!ParseEnumerationScope(info, &scope))
+    return;
+
+  auto operation = new EnumerateProcessesOperation(scope);
   operation->Schedule(isolate, wrapper);
 
   info.GetReturnValue().Set(operation->GetPromise(isolate));
@@ -349,6 +423,10 @@ class EnumeratePendingSpawnsOperation : public Operation<FridaDevice> {
     return pending_spawns;
   }
 
+  void Discard() {
+    g_object_unref(pending_spawns_);
+  }
+
   FridaSpawnList* pending_spawns_;
 };
 
@@ -390,6 +468,10 @@ class SpawnOperation : public Operation<FridaDevice> {
     return Nan::New<v8::Uint32>(pid_);
   }
 
+  void Discard() {
+    frida_device_kill(handle_, pid_, NULL, NULL);
+  }
+
   gchar* path_;
   gchar** argv_;
   gchar** envp_;
@@ -533,6 +615,11 @@ class AttachOperation : public Operation<FridaDevice> {
     return wrapper;
   }
 
+  void Discard() {
+    frida_session_detach(session_, NULL, NULL);
+    g_object_unref(session_);
+  }
+
   const guint pid_;
   FridaSession* session_;
 };
@@ -558,6 +645,31 @@ NAN_METHOD(Device::Attach) {
   info.GetReturnValue().Set(operation->GetPromise(isolate));
 }
 
+static bool ParseEnumerationScope(const Nan::FunctionCallbackInfo<Value>& info,
+    EnumerationScope* scope) {
+  *scope = SCOPE_METADATA;
+  if (info.Length() < 1 || info[0]->IsUndefined())
+    return true;
+
+  if (info[0]->IsString()) {
+    String::Utf8Value name(Local<String>::Cast(info[0]));
+    if (strcmp(*name, "minimal") == 0) {
+      *scope = SCOPE_MINIMAL;
+      return true;
+    } else if (strcmp(*name, "metadata") == 0) {
+      *scope = SCOPE_METADATA;
+      return true;
+    } else if (strcmp(*name, "full") == 0) {
+      *scope = SCOPE_FULL;
+      return true;
+    }
+  }
+
+  Nan::ThrowTypeError(
+      "Bad argument, expected scope of 'minimal', 'metadata' or 'full'");
+  return false;
+}
+
 Local<Value> Device::TransformSpawnedEvent(const gchar* name, guint index,
     const GValue* value, gpointer user_data) {
   if (index != 0 || strcmp(name, "spawned") != 0)
@@ -567,18 +679,18 @@ Local<Value> Device::TransformSpawnedEvent(const gchar* name, guint index,
 }
 
 void Device::OnListen(const gchar* signal, gpointer user_data) {
-  auto wrapper = static_cast<Device*>(user_data);
+  auto runtime = static_cast<Runtime*>(user_data);
 
   if (strcmp(signal, "spawned") == 0) {
-    wrapper->runtime_->GetUVContext()->IncreaseUsage();
+    runtime->GetUVContext()->IncreaseUsage();
   }
 }
 
 void Device::OnUnlisten(const gchar* signal, gpointer user_data) {
-  auto wrapper = static_cast<Device*>(user_data);
+  auto runtime = static_cast<Runtime*>(user_data);
 
   if (strcmp(signal, "spawned") == 0) {
-    wrapper->runtime_->GetUVContext()->DecreaseUsage();
+    runtime->GetUVContext()->DecreaseUsage();
   }
 }
 
@@ -25,6 +25,7 @@ class Device : public GLibObject {
   static NAN_PROPERTY_GETTER(GetType);
 
   static NAN_METHOD(GetFrontmostApplication);
+  static NAN_METHOD(WatchFrontmostApplication);
   static NAN_METHOD(EnumerateApplications);
   static NAN_METHOD(EnumerateProcesses);
   static NAN_METHOD(EnableSpawnGating);
@@ -73,8 +73,8 @@ NAN_METHOD(DeviceManager::New) {
     g_object_unref(handle);
 
     auto events_wrapper = ObjectWrap::Unwrap<Events>(events_obj);
-    events_wrapper->SetListenCallback(OnListen, wrapper);
-    events_wrapper->SetUnlistenCallback(OnUnlisten, wrapper);
+    events_wrapper->SetListenCallback(OnListen, runtime);
+    events_wrapper->SetUnlistenCallback(OnUnlisten, runtime);
 
     info.GetReturnValue().Set(obj);
   } else {
@@ -134,6 +134,10 @@ class EnumerateDevicesOperation : public Operation<FridaDeviceManager> {
     return devices;
   }
 
+  void Discard() {
+    frida_unref(devices_);
+  }
+
   FridaDeviceList* devices_;
 };
 
@@ -165,18 +169,18 @@ static bool IsDeviceChangeSignal(const gchar* signal) {
 }
 
 void DeviceManager::OnListen(const gchar* signal, gpointer user_data) {
-  auto wrapper = static_cast<DeviceManager*>(user_data);
+  auto runtime = static_cast<Runtime*>(user_data);
 
   if (IsDeviceChangeSignal(signal)) {
-    wrapper->runtime_->GetUVContext()->IncreaseUsage();
+    runtime->GetUVContext()->IncreaseUsage();
   }
 }
 
 void DeviceManager::OnUnlisten(const gchar* signal, gpointer user_data) {
-  auto wrapper = static_cast<DeviceManager*>(user_data);
+  auto runtime = static_cast<Runtime*>(user_data);
 
   if (IsDeviceChangeSignal(signal)) {
-    wrapper->runtime_->GetUVContext()->DecreaseUsage();
+    runtime->GetUVContext()->DecreaseUsage();
   }
 }
 
@@ -0,0 +1,639 @@
+#include "eh_frame.h"
+
+#include <algorithm>
+#include <cstring>
+#include <gio/gio.h>
+
+#define ELF_PT_LOAD 1
+#define ELF_PT_NOTE 4
+#define ELF_NT_GNU_BUILD_ID 3
+#define ELF_PT_GNU_EH_FRAME 0x6474e550
+
+#define DW_EH_PE_OMIT 0xff
+#define DW_EH_PE_FORMAT_MASK 0x0f
+#define DW_EH_PE_APPLICATION_MASK 0x70
+#define DW_EH_PE_INDIRECT 0x80
+#define DW_EH_PE_PCREL 0x10
+#define DW_EH_PE_DATAREL 0x30
+
+#define CFI_MAX_REMEMBERED_STATES 16
+
+namespace frida {
+
+struct EhFrame::Cie {
+  guint64 code_alignment;
+  gint64 data_alignment;
+  guint return_address_register;
+  guint8 fde_encoding;
+  bool has_augmentation_data;
+  const guint8* instructions;
+  gsize instructions_size;
+};
+
+// Bounds-checked little-endian reader; running off the end clears ok
+// instead of faulting, so truncated or corrupt files are harmless.
+class ByteReader {
+ public:
+  ByteReader(const guint8* data, gsize size, gsize offset)
+      : data_(data),
+        size_(size),
+        offset_(offset),
+        ok_(offset <= size) {
+  }
+
+  bool ok() const { return ok_; }
+  gsize offset() const { return offset_; }
+  void Seek(gsize offset) {
+    if (offset > size_)
+      ok_ = false;
+    else
+      offset_ = offset;
+  }
+  void Skip(gsize n) { Seek(offset_ + n); }
+
+  guint8 U8() { return static_cast<guint8>(Read(1)); }
+  guint16 U16() { return static_cast<guint16>(Read(2)); }
+  guint32 U32() { return static_cast<guint32>(Read(4)); }
+  guint64 U64() { return Read(8); }
+
+  guint64 Uleb() {
+    guint64 result = 0;
+    guint shift = 0;
+    guint8 byte;
+    do {
+      byte = U8();
+      if (shift < 64)
+        result |= static_cast<guint64>(byte & 0x7f) << shift;
+      shift += 7;
+    } while (ok_ && (byte & 0x80) != 0);
+    return result;
+  }
+
+  gint64 Sleb() {
+    gint64 result = 0;
+    guint shift = 0;
+    guint8 byte;
+    do {
+      byte = U8();
+      if (shift < 64)
+        result |= static_cast<gint64>(byte & 0x7f) << shift;
+      shift += 7;
+    } while (ok_ && (byte & 0x80) != 0);
+    if (shift < 64 && (byte & 0x40) != 0)
+      result |= -(static_cast<gint64>(1) << shift);
+    return result;
+  }
+
+  const gchar* CString() {
+    auto start = reinterpret_cast<const gchar*>(data_ + offset_);
+    while (ok_ && U8() != 0) {
+    }
+    return ok_ ? start : "";
+  }
+
+  // Reads a pointer in one of the DW_EH_PE_* encodings. `address` is the
+  // virtual address of the reader's current offset, for pc-relative values.
+  guint64 Encoded(guint8 encoding, guint64 address, guint64 data_base) {
+    if (encoding == DW_EH_PE_OMIT)
+      return 0;
+
+    guint64 value;
+    switch (encoding & DW_EH_PE_FORMAT_MASK) {
+      case 0x00: value = U64(); break;
+      case 0x01: value = Uleb(); break;
+      case 0x02: value = U16(); break;
+      case 0x03: value = U32(); break;
+      case 0x04: value = U64(); break;
+      case 0x09: value = Sleb(); break;
+      case 0x0a: value = static_cast<gint16>(U16()); break;
+      case 0x0b: value = static_cast<gint32>(U32()); break;
+      case 0x0c: value = U64(); break;
+      default:
+        ok_ = false;
+        return 0;
+    }
+
+    switch (encoding & DW_EH_PE_APPLICATION_MASK) {
+      case 0x00: break;
+      case DW_EH_PE_PCREL: value += address; break;
+      case DW_EH_PE_DATAREL: value += data_base; break;
+      default:
+        ok_ = false;
+        return 0;
+    }
+
+    if ((encoding & DW_EH_PE_INDIRECT) != 0)
+      ok_ = false;
+
+    return value;
+  }
+
+ private:
+  guint64 Read(gsize n) {
+    if (!ok_ || size_ - offset_ < n) {
+      ok_ = false;
+      return 0;
+    }
+    guint64 value = 0;
+    for (gsize i = 0; i != n; i++)
+      value |= static_cast<guint64>(data_[offset_ + i]) << (8 * i);
+    offset_ += n;
+    return value;
+  }
+
+  const guint8* data_;
+  gsize size_;
+  gsize offset_;
+  bool ok_;
+};
+
+EhFrame::EhFrame(GMappedFile* file)
+    : file_(file),
+      data_(reinterpret_cast<const guint8*>(g_mapped_file_get_contents(file))),
+      size_(g_mapped_file_get_length(file)),
+      load_address_(0),
+      eh_frame_offset_(0),
+      eh_frame_end_(0),
+      eh_frame_address_(0) {
+}
+
+EhFrame::~EhFrame() {
+  g_mapped_file_unref(file_);
+}
+
+EhFrame* EhFrame::Load(const gchar* path, GError** error) {
+  auto file = g_mapped_file_new(path, FALSE, error);
+  if (file == NULL)
+    return NULL;
+
+  auto eh_frame = new EhFrame(file);
+  if (!eh_frame->Parse(error)) {
+    delete eh_frame;
+    return NULL;
+  }
+  return eh_frame;
+}
+
+guint64 EhFrame::GetLoadAddress() const {
+  return load_address_;
+}
+
+const std::string& EhFrame::GetBuildId() const {
+  return build_id_;
+}
+
+bool EhFrame::Parse(GError** error) {
+  ByteReader header(data_, size_, 0);
+  auto magic = header.U32();
+  auto elf_class = header.U8();
+  auto elf_data = header.U8();
+  if (!header.ok() || magic != 0x464c457f || elf_class != 2 || elf_data != 1) {
+    g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+        "Not a 64-bit little-endian ELF image");
+    return false;
+  }
+
+  header.Seek(0x20);
+  auto phoff = header.U64();
+  header.Seek(0x36);
+  auto phentsize = header.U16();
+  auto phnum = header.U16();
+
+  bool have_load = false;
+  gsize hdr_offset = 0;
+  guint64 hdr_address = 0;
+  bool have_hdr = false;
+  for (guint i = 0; i != phnum; i++) {
+    ByteReader ph(data_, size_, phoff + i * static_cast<gsize>(phentsize));
+    auto type = ph.U32();
+    ph.Skip(4);
+    auto offset = ph.U64();
+    auto address = ph.U64();
+    ph.Skip(8);
+    auto file_size = ph.U64();
+    if (!ph.ok())
+      break;
+
+    if (type == ELF_PT_LOAD) {
+      if (!have_load) {
+        load_address_ = address & ~static_cast<guint64>(0xfff);
+        have_load = true;
+      }
+      segments_.push_back({ address, offset, file_size });
+    } else if (type == ELF_PT_NOTE) {
+      if (build_id_.empty())
+        ParseBuildId(offset, file_size);
+    } else if (type == ELF_PT_GNU_EH_FRAME) {
+      hdr_offset = offset;
+      hdr_address = address;
+      have_hdr = true;
+    }
+  }
+
+  if (!have_load || !have_hdr) {
+    g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+        "No unwind information");
+    return false;
+  }
+
+  ByteReader hdr(data_, size_, hdr_offset);
+  auto version = hdr.U8();
+  auto eh_frame_ptr_encoding = hdr.U8();
+  if (!hdr.ok() || version != 1) {
+    g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+        "Unsupported .eh_frame_hdr");
+    return false;
+  }
+  hdr.Skip(2);
+  eh_frame_address_ = hdr.Encoded(eh_frame_ptr_encoding,
+      hdr_address + (hdr.offset() - hdr_offset), hdr_address);
+  if (!hdr.ok() || !OffsetOfAddress(eh_frame_address_, &eh_frame_offset_)) {
+    g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+        "Unsupported .eh_frame_hdr");
+    return false;
+  }
+
+  eh_frame_end_ = size_;
+  for (auto& segment : segments_) {
+    if (eh_frame_offset_ >= segment.offset &&
+        eh_frame_offset_ < segment.offset + segment.size) {
+      eh_frame_end_ = std::min<gsize>(size_, segment.offset + segment.size);
+      break;
+    }
+  }
+
+  if (!IndexFromHeader(hdr_offset, hdr_address))
+    IndexByScanning();
+
+  return true;
+}
+
+void EhFrame::ParseBuildId(gsize offset, gsize size) {
+  if (offset > size_)
+    return;
+  auto end = offset + std::min<gsize>(size, size_ - offset);
+  while (end - offset >= 12) {
+    ByteReader note(data_, end, offset);
+    auto name_size = note.U32();
+    auto desc_size = note.U32();
+    auto type = note.U32();
+    auto name_offset = note.offset();
+    note.Skip((name_size + 3) & ~3U);
+    auto desc_offset = note.offset();
+    note.Skip((desc_size + 3) & ~3U);
+    if (!note.ok())
+      return;
+
+    if (type == ELF_NT_GNU_BUILD_ID && name_size == 4 &&
+        memcmp(data_ + name_offset, "GNU", 4) == 0) {
+      static const gchar digits[] = "0123456789abcdef";
+      for (gsize i = 0; i != desc_size; i++) {
+        auto b = data_[desc_offset + i];
+        build_id_ += digits[b >> 4];
+        build_id_ += digits[b & 0xf];
+      }
+      return;
+    }
+    offset = note.offset();
+  }
+}
+
+bool EhFrame::IndexFromHeader(gsize hdr_offset, guint64 hdr_address) {
+  ByteReader hdr(data_, size_, hdr_offset + 1);
+  auto eh_frame_ptr_encoding = hdr.U8();
+  auto fde_count_encoding = hdr.U8();
+  auto table_encoding = hdr.U8();
+  hdr.Encoded(eh_frame_ptr_encoding,
+      hdr_address + (hdr.offset() - hdr_offset), hdr_address);
+  if (fde_count_encoding == DW_EH_PE_OMIT || table_encoding == DW_EH_PE_OMIT)
+    return false;
+  auto count = hdr.Encoded(fde_count_encoding,
+      hdr_address + (hdr.offset() - hdr_offset), hdr_address);
+  if (!hdr.ok())
+    return false;
+
+  index_.reserve(count);
+  for (guint64 i = 0; i != count; i++) {
+    auto pc = hdr.Encoded(table_encoding,
+        hdr_address + (hdr.offset() - hdr_offset), hdr_address);
+    auto fde = hdr.Encoded(table_encoding,
+        hdr_address + (hdr.offset() - hdr_offset), hdr_address);
+    if (!hdr.ok()) {
+      index_.clear();
+      return false;
+    }
+    index_.push_back(std::make_pair(pc, fde));
+  }
+  return true;
+}
+
+void EhFrame::IndexByScanning() {
+  gsize offset = eh_frame_offset_;
+  while (offset < eh_frame_end_) {
+    ByteReader entry(data_, eh_frame_end_, offset);
+    guint64 length = entry.U32();
+    if (length == 0xffffffff)
+      length = entry.U64();
+    if (!entry.ok() || length == 0)
+      break;
+    auto id_offset = entry.offset();
+    auto end = id_offset + length;
+    auto cie_pointer = entry.U32();
+
+    Cie cie;
+    if (cie_pointer != 0 && ParseCie(id_offset - cie_pointer, &cie)) {
+      auto address = eh_frame_address_ + (entry.offset() - eh_frame_offset_);
+      auto pc = entry.Encoded(cie.fde_encoding, address, 0);
+      if (entry.ok()) {
+        index_.push_back(std::make_pair(pc,
+            eh_frame_address_ + (offset - eh_frame_offset_)));
+      }
+    }
+
+    offset = end;
+  }
+
+  std::sort(index_.begin(), index_.end());
+}
+
+bool EhFrame::OffsetOfAddress(guint64 address, gsize* offset) const {
+  for (auto& segment : segments_) {
+    if (address >= segment.address &&
+        address < segment.address + segment.size) {
+      *offset = segment.offset + (address - segment.address);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool EhFrame::ParseCie(gsize offset, Cie* cie) const {
+  ByteReader reader(data_, eh_frame_end_, offset);
+  guint64 length = reader.U32();
+  if (length == 0xffffffff)
+    length = reader.U64();
+  auto end = reader.offset() + length;
+  auto id = reader.U32();
+  auto version = reader.U8();
+  auto augmentation = reader.CString();
+  if (!reader.ok() || id != 0 || end > eh_frame_end_)
+    return false;
+
+  if (strstr(augmentation, "eh") != NULL)
+    reader.Skip(8);
+  cie->code_alignment = reader.Uleb();
+  cie->data_alignment = reader.Sleb();
+  cie->return_address_register =
+      (version == 1) ? reader.U8() : static_cast<guint>(reader.Uleb());
+  cie->fde_encoding = 0;
+  cie->has_augmentation_data = augmentation[0] == 'z';
+
+  if (cie->has_augmentation_data) {
+    auto augmentation_size = reader.Uleb();
+    auto augmentation_end = reader.offset() + augmentation_size;
+    for (auto p = augmentation + 1; *p != '\0' && reader.ok(); p++) {
+      if (*p == 'R') {
+        cie->fde_encoding = reader.U8();
+      } else if (*p == 'P') {
+        auto encoding = reader.U8();
+        auto address = eh_frame_address_ + (reader.offset() - eh_frame_offset_);
+        reader.Encoded(encoding & ~DW_EH_PE_INDIRECT, address, 0);
+      } else if (*p == 'L') {
+        reader.U8();
+      } else if (*p != 'S' && *p != 'B') {
+        break;
+      }
+    }
+    reader.Seek(augmentation_end);
+  }
+
+  if (!reader.ok() || reader.offset() > end)
+    return false;
+  cie->instructions = data_ + reader.offset();
+  cie->instructions_size = end - reader.offset();
+  return true;
+}
+
+bool EhFrame::FindRow(guint64 pc, CfiRow* row) const {
+  auto upper = std::upper_bound(index_.begin(), index_.end(),
+      std::make_pair(pc, G_MAXUINT64));
+  if (upper == index_.begin())
+    return false;
+  auto fde_address = (upper - 1)->second;
+
+  gsize offset;
+  if (fde_address < eh_frame_address_)
+    return false;
+  offset = eh_frame_offset_ + (fde_address - eh_frame_address_);
+
+  ByteReader reader(data_, eh_frame_end_, offset);
+  guint64 length = reader.U32();
+  if (length == 0xffffffff)
+    length = reader.U64();
+  auto id_offset = reader.offset();
+  auto end = id_offset + length;
+  auto cie_pointer = reader.U32();
+  if (!reader.ok() || cie_pointer == 0 || end > eh_frame_end_)
+    return false;
+
+  Cie cie;
+  if (!ParseCie(id_offset - cie_pointer, &cie))
+    return false;
+
+  auto address = eh_frame_address_ + (reader.offset() - eh_frame_offset_);
+  auto pc_begin = reader.Encoded(cie.fde_encoding, address, 0);
+  auto pc_range = reader.Encoded(cie.fde_encoding & DW_EH_PE_FORMAT_MASK, 0,
+      0);
+  if (!reader.ok() || pc < pc_begin || pc >= pc_begin + pc_range)
+    return false;
+  if (cie.has_augmentation_data)
+    reader.Skip(reader.Uleb());
+  if (!reader.ok() || reader.offset() > end)
+    return false;
+
+  CfiRow initial;
+  initial.cfa_valid = false;
+  initial.cfa_register = 0;
+  initial.cfa_offset = 0;
+  for (guint i = 0; i != CFI_X64_REGISTER_COUNT; i++) {
+    initial.rules[i].kind = CFI_RULE_SAME_VALUE;
+    initial.rules[i].value = 0;
+  }
+  if (!Execute(cie.instructions, cie.instructions_size, cie, pc_begin,
+      G_MAXUINT64, initial, &initial))
+    return false;
+
+  *row = initial;
+  return Execute(data_ + reader.offset(), end - reader.offset(), cie,
+      pc_begin, pc, initial, row);
+}
+
+// Rules for registers we do not track are dropped.
+static void SetRule(CfiRow* row, guint64 reg, CfiRuleKind kind, gint64 value) {
+  if (reg < CFI_X64_REGISTER_COUNT) {
+    row->rules[reg].kind = kind;
+    row->rules[reg].value = value;
+  }
+}
+
+bool EhFrame::Execute(const guint8* instructions, gsize size, const Cie& cie,
+    guint64 location, guint64 pc, const CfiRow& initial, CfiRow* row) const {
+  ByteReader reader(instructions, size, 0);
+  CfiRow remembered[CFI_MAX_REMEMBERED_STATES];
+  guint depth = 0;
+
+  while (reader.ok() && reader.offset() < size) {
+    auto op = reader.U8();
+    auto operand = op & 0x3f;
+    guint64 delta = 0;
+    bool advance = false;
+
+    switch (op & 0xc0) {
+      case 0x40:
+        delta = operand * cie.code_alignment;
+        advance = true;
+        break;
+      case 0x80:
+        SetRule(row, operand, CFI_RULE_OFFSET,
+            static_cast<gint64>(reader.Uleb()) * cie.data_alignment);
+        break;
+      case 0xc0:
+        if (operand < CFI_X64_REGISTER_COUNT)
+          row->rules[operand] = initial.rules[operand];
+        break;
+      default:
+        switch (op) {
+          case 0x00:
+            break;
+          case 0x01: {
+            auto address = reader.Encoded(cie.fde_encoding, 0, 0);
+            if (address > pc)
+              return true;
+            location = address;
+            break;
+          }
+          case 0x02:
+            delta = reader.U8() * cie.code_alignment;
+            advance = true;
+            break;
+          case 0x03:
+            delta = reader.U16() * cie.code_alignment;
+            advance = true;
+            break;
+          case 0x04:
+            delta = reader.U32() * cie.code_alignment;
+            advance = true;
+            break;
+          case 0x05: {
+            auto reg = reader.Uleb();
+            SetRule(row, reg, CFI_RULE_OFFSET,
+                static_cast<gint64>(reader.Uleb()) * cie.data_alignment);
+            break;
+          }
+          case 0x06: {
+            auto reg = reader.Uleb();
+            if (reg < CFI_X64_REGISTER_COUNT)
+              row->rules[reg] = initial.rules[reg];
+            break;
+          }
+          case 0x07:
+            SetRule(row, reader.Uleb(), CFI_RULE_UNDEFINED, 0);
+            break;
+          case 0x08:
+            SetRule(row, reader.Uleb(), CFI_RULE_SAME_VALUE, 0);
+            break;
+          case 0x09: {
+            auto reg = reader.Uleb();
+            SetRule(row, reg, CFI_RULE_REGISTER, reader.Uleb());
+            break;
+          }
+          case 0x0a:
+            if (depth == CFI_MAX_REMEMBERED_STATES)
+              return false;
+            remembered[depth++] = *row;
+            break;
+          case 0x0b:
+            if (depth == 0)
+              return false;
+            *row = remembered[--depth];
+            break;
+          case 0x0c:
+            row->cfa_register = reader.Uleb();
+            row->cfa_offset = reader.Uleb();
+            row->cfa_valid = true;
+            break;
+          case 0x0d:
+            row->cfa_register = reader.Uleb();
+            break;
+          case 0x0e:
+            row->cfa_offset = reader.Uleb();
+            break;
+          case 0x0f:
+            // CFA expressions are not evaluated; the row is returned with
+            // cfa_valid cleared, which ends the unwind.
+            reader.Skip(reader.Uleb());
+            row->cfa_valid = false;
+            break;
+          case 0x10: {
+            auto reg = reader.Uleb();
+            reader.Skip(reader.Uleb());
+            SetRule(row, reg, CFI_RULE_UNDEFINED, 0);
+            break;
+          }
+          case 0x11: {
+            auto reg = reader.Uleb();
+            SetRule(row, reg, CFI_RULE_OFFSET,
+                reader.Sleb() * cie.data_alignment);
+            break;
+          }
+          case 0x12:
+            row->cfa_register = reader.Uleb();
+            row->cfa_offset = reader.Sleb() * cie.data_alignment;
+            row->cfa_valid = true;
+            break;
+          case 0x13:
+            row->cfa_offset = reader.Sleb() * cie.data_alignment;
+            break;
+          case 0x14: {
+            auto reg = reader.Uleb();
+            SetRule(row, reg, CFI_RULE_VAL_OFFSET,
+                static_cast<gint64>(reader.Uleb()) * cie.data_alignment);
+            break;
+          }
+          case 0x15: {
+            auto reg = reader.Uleb();
+            SetRule(row, reg, CFI_RULE_VAL_OFFSET,
+                reader.Sleb() * cie.data_alignment);
+            break;
+          }
+          case 0x16: {
+            auto reg = reader.Uleb();
+            reader.Skip(reader.Uleb());
+            SetRule(row, reg, CFI_RULE_UNDEFINED, 0);
+            break;
+          }
+          case 0x2e:
+            reader.Uleb();
+            break;
+          case 0x2f: {
+            auto reg = reader.Uleb();
+            SetRule(row, reg, CFI_RULE_OFFSET,
+                -static_cast<gint64>(reader.Uleb()) * cie.data_alignment);
+            break;
+          }
+          default:
+            return false;
+        }
+    }
+
+    if (advance) {
+      if (location + delta > pc)
+        return true;
+      location += delta;
+    }
+  }
+
+  return reader.ok();
+}
+
+}
@@ -0,0 +1,88 @@
+#ifndef FRIDANODE_EH_FRAME_H
+#define FRIDANODE_EH_FRAME_H
+
+#include <glib.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace frida {
+
+enum CfiRuleKind {
+  CFI_RULE_UNDEFINED,
+  CFI_RULE_SAME_VALUE,
+  CFI_RULE_OFFSET,
+  CFI_RULE_VAL_OFFSET,
+  CFI_RULE_REGISTER
+};
+
+// DWARF register numbering for x86-64; the return address column is 16.
+enum {
+  CFI_X64_RBP = 6,
+  CFI_X64_RSP = 7,
+  CFI_X64_RA = 16,
+  CFI_X64_REGISTER_COUNT = 17
+};
+
+struct CfiRule {
+  CfiRuleKind kind;
+  gint64 value;
+};
+
+struct CfiRow {
+  bool cfa_valid;
+  guint cfa_register;
+  gint64 cfa_offset;
+  CfiRule rules[CFI_X64_REGISTER_COUNT];
+};
+
+// Call frame information of one ELF image on disk, looked up through the
+// .eh_frame_hdr search table, or by scanning .eh_frame when there is none.
+// Addresses are link-time virtual addresses; callers subtract the load
+// bias. Only 64-bit little-endian images are supported.
+class EhFrame {
+ public:
+  static EhFrame* Load(const gchar* path, GError** error);
+  ~EhFrame();
+
+  guint64 GetLoadAddress() const;
+  // Lowercase hex of the GNU build-id note, or empty if there is none.
+  const std::string& GetBuildId() const;
+  bool FindRow(guint64 pc, CfiRow* row) const;
+
+ private:
+  struct Cie;
+  struct Segment {
+    guint64 address;
+    gsize offset;
+    gsize size;
+  };
+
+  EhFrame(GMappedFile* file);
+
+  bool Parse(GError** error);
+  void ParseBuildId(gsize offset, gsize size);
+  bool IndexFromHeader(gsize hdr_offset, guint64 hdr_address);
+  void IndexByScanning();
+  bool OffsetOfAddress(guint64 address, gsize* offset) const;
+  bool ParseCie(gsize offset, Cie* cie) const;
+  bool Execute(const guint8* instructions, gsize size, const Cie& cie,
+      guint64 location, guint64 pc, const CfiRow& initial,
+      CfiRow* row) const;
+
+  GMappedFile* file_;
+  const guint8* data_;
+  gsize size_;
+  guint64 load_address_;
+  gsize eh_frame_offset_;
+  gsize eh_frame_end_;
+  guint64 eh_frame_address_;
+  std::string build_id_;
+  std::vector<Segment> segments_;
+  std::vector<std::pair<guint64, guint64>> index_;
+};
+
+}
+
+#endif
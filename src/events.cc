@@ -1,10 +1,13 @@
 #include "events.h"
 
+#include "message_filter.h"
+
 #include <cstring>
 #include <nan.h>
 #include <node.h>
 
 #define EVENTS_DATA_CONSTRUCTOR "events:ctor"
+#define EVENTS_BATCH_PREFIX "{\"type\":\"send\",\"payload\":[\"frida:batch\""
 
 using v8::Boolean;
 using v8::Exception;
@@ -29,23 +32,39 @@ struct _EventsClosure {
   gboolean alive;
   guint signal_id;
   guint handler_id;
-  v8::Persistent<Function>* callback;
-  v8::Persistent<Object>* parent;
+  Nan::Persistent<Function>* callback;
+  Nan::Persistent<Object>* parent;
+  Events* owner;
   Events::TransformCallback transform;
   gpointer transform_data;
+  MessageFilter* filter;
+  gboolean raw;
   Runtime* runtime;
 };
 
 static EventsClosure* events_closure_new(guint signal_id,
-    Handle<Function> callback, Handle<Object> parent,
+    Handle<Function> callback, Handle<Object> parent, Events* owner,
     Events::TransformCallback transform, gpointer transform_data,
-    Runtime* runtime);
+    MessageFilter* filter, gboolean raw, gboolean weak, Runtime* runtime);
 static void events_closure_finalize(gpointer data, GClosure* closure);
 static void events_closure_marshal(GClosure* closure, GValue* return_gvalue,
     guint n_param_values, const GValue* param_values, gpointer invocation_hint,
     gpointer marshal_data);
+static void events_closure_schedule(EventsClosure* self, GArray* args);
+static gboolean events_closure_accepts(EventsClosure* self,
+    guint n_param_values, const GValue* param_values);
+static void events_closure_deliver_batch(EventsClosure* self,
+    const gchar* message, const guint8* data, gint data_size);
+static JsonNode* events_parse_message(const gchar* message);
 static Local<Value> events_closure_gvalue_to_jsvalue(const GValue* gvalue);
 
+// Every filtered closure connected to a signal sees the same message, so the
+// last one parsed is kept around for the others. Only touched from the
+// frida thread, but guarded anyway since signals may be emitted elsewhere.
+G_LOCK_DEFINE_STATIC(events_parse_cache);
+static gchar* events_parse_cache_message = NULL;
+static JsonParser* events_parse_cache_parser = NULL;
+
 Events::Events(gpointer handle, TransformCallback transform,
     gpointer transform_data, Runtime* runtime)
     : GLibObject(handle, runtime),
@@ -59,9 +78,36 @@ Events::Events(gpointer handle, TransformCallback transform,
   g_object_ref(handle_);
 }
 
+// Strong listeners keep us alive, so any left here are weak ones whose
+// callbacks are still around. This runs from within the collector, so they
+// are disconnected without calling back into JavaScript.
 Events::~Events() {
-  g_assert(closures_ == NULL); // They keep us alive
-  frida_unref(handle_);
+  for (GSList* cur = closures_; cur != NULL; cur = cur->next) {
+    auto events_closure = static_cast<EventsClosure*>(cur->data);
+    events_closure->alive = FALSE;
+    events_closure->owner = NULL;
+    events_closure->callback->Reset();
+
+    if (unlisten_ != NULL) {
+      unlisten_(g_signal_name(events_closure->signal_id), unlisten_data_);
+    }
+  }
+
+  auto handle = handle_;
+  auto closures = closures_;
+  auto runtime = runtime_;
+  runtime->GetGLibContext()->Schedule([=]() {
+    for (GSList* cur = closures; cur != NULL; cur = cur->next) {
+      auto events_closure = static_cast<EventsClosure*>(cur->data);
+      g_assert(events_closure->handler_id != 0);
+      g_signal_handler_disconnect(handle, events_closure->handler_id);
+    }
+    frida_unref(handle);
+    runtime->GetUVContext()->Schedule([=]() {
+      g_slist_free_full(closures,
+          reinterpret_cast<GDestroyNotify>(g_closure_unref));
+    });
+  });
 }
 
 void Events::Init(Handle<Object> exports, Runtime* runtime) {
@@ -139,8 +185,21 @@ NAN_METHOD(Events::Listen) {
   if (!wrapper->GetSignalArguments(info, signal_id, callback))
     return;
 
-  auto events_closure = events_closure_new(signal_id, callback, obj,
-      wrapper->transform_, wrapper->transform_data_, runtime);
+  MessageFilter* filter = NULL;
+  gboolean raw = FALSE;
+  gboolean weak = FALSE;
+  if (!wrapper->GetListenOptions(info, signal_id, &filter, &raw, &weak))
+    return;
+
+  auto events_closure = events_closure_new(signal_id, callback, obj, wrapper,
+      wrapper->transform_, wrapper->transform_data_, filter, raw, weak,
+      runtime);
+  if (weak) {
+    // The handler goes away with the callback, so a forgotten listener
+    // no longer keeps whatever the callback references alive, nor us.
+    events_closure->callback->SetWeak(events_closure, OnCallbackCollected,
+        Nan::WeakCallbackType::kParameter);
+  }
   auto closure = reinterpret_cast<GClosure*>(events_closure);
   g_closure_ref(closure);
   g_closure_sink(closure);
@@ -167,31 +226,60 @@ NAN_METHOD(Events::Unlisten) {
 
   for (GSList* cur = wrapper->closures_; cur != NULL; cur = cur->next) {
     auto events_closure = static_cast<EventsClosure*>(cur->data);
-    auto closure = reinterpret_cast<GClosure*>(events_closure);
+    if (!events_closure->alive)
+      continue;
     auto closure_callback = Nan::New<v8::Function>(*events_closure->callback);
     if (events_closure->signal_id == signal_id &&
         closure_callback->SameValue(callback)) {
-      if (wrapper->unlisten_ != NULL) {
-        wrapper->unlisten_(g_signal_name(signal_id), wrapper->unlisten_data_);
-      }
+      wrapper->Disconnect(cur);
+      break;
+    }
+  }
+}
 
-      wrapper->closures_ = g_slist_delete_link(wrapper->closures_, cur);
+void Events::Disconnect(GSList* link) {
+  auto events_closure = static_cast<EventsClosure*>(link->data);
+  auto closure = reinterpret_cast<GClosure*>(events_closure);
 
-      events_closure->alive = FALSE;
+  if (unlisten_ != NULL) {
+    unlisten_(g_signal_name(events_closure->signal_id), unlisten_data_);
+  }
 
-      auto runtime = wrapper->runtime_;
-      runtime->GetGLibContext()->Schedule([=]() {
-        g_assert(events_closure->handler_id != 0);
-        g_signal_handler_disconnect(wrapper->handle_,
-            events_closure->handler_id);
-        runtime->GetUVContext()->Schedule([=]() {
-          g_closure_unref(closure);
-        });
-      });
+  closures_ = g_slist_delete_link(closures_, link);
 
-      break;
+  events_closure->alive = FALSE;
+
+  auto handle = handle_;
+  auto runtime = runtime_;
+  runtime->GetGLibContext()->Schedule([=]() {
+    g_assert(events_closure->handler_id != 0);
+    g_signal_handler_disconnect(handle, events_closure->handler_id);
+    runtime->GetUVContext()->Schedule([=]() {
+      g_closure_unref(closure);
+    });
+  });
+}
+
+// Nothing but resetting handles is allowed while the collector is at work,
+// and disconnecting calls the unlisten hook, so that is left to the next
+// turn of the loop.
+void Events::OnCallbackCollected(
+    const Nan::WeakCallbackInfo<EventsClosure>& data) {
+  auto events_closure = data.GetParameter();
+  events_closure->callback->Reset();
+  events_closure->alive = FALSE;
+
+  auto closure = reinterpret_cast<GClosure*>(events_closure);
+  g_closure_ref(closure);
+  events_closure->runtime->GetUVContext()->Schedule([=]() {
+    auto wrapper = events_closure->owner;
+    if (wrapper != NULL) {
+      auto link = g_slist_find(wrapper->closures_, events_closure);
+      if (link != NULL)
+        wrapper->Disconnect(link);
     }
-  }
+    g_closure_unref(closure);
+  });
 }
 
 bool Events::GetSignalArguments(const Nan::FunctionCallbackInfo<Value>& info,
@@ -210,12 +298,53 @@ bool Events::GetSignalArguments(const Nan::FunctionCallbackInfo<Value>& info,
   return true;
 }
 
+bool Events::GetListenOptions(const Nan::FunctionCallbackInfo<Value>& info,
+    guint signal_id, MessageFilter** filter, gboolean* raw, gboolean* weak) {
+  if (info.Length() < 3 || info[2]->IsUndefined() || info[2]->IsNull())
+    return true;
+  if (!info[2]->IsObject()) {
+    Nan::ThrowTypeError("Bad argument, expected options object");
+    return false;
+  }
+  auto options = Local<Object>::Cast(info[2]);
+
+  auto filter_value = Nan::Get(options,
+      Nan::New("filter").ToLocalChecked()).ToLocalChecked();
+  auto has_filter = !filter_value->IsUndefined() && !filter_value->IsNull();
+  *raw = Nan::Get(options,
+      Nan::New("raw").ToLocalChecked()).ToLocalChecked()->BooleanValue();
+  *weak = Nan::Get(options,
+      Nan::New("weak").ToLocalChecked()).ToLocalChecked()->BooleanValue();
+  if (!has_filter && !*raw)
+    return true;
+
+  GSignalQuery query;
+  g_signal_query(signal_id, &query);
+  if (query.n_params < 1 ||
+      (query.param_types[0] & ~G_SIGNAL_TYPE_STATIC_SCOPE) != G_TYPE_STRING) {
+    Nan::ThrowTypeError(
+        "Filters and raw delivery are only supported for message signals");
+    return false;
+  }
+
+  if (has_filter) {
+    String::Utf8Value spec(runtime_->ValueToJson(filter_value));
+    GError* error = NULL;
+    *filter = MessageFilter::Compile(*spec, &error);
+    if (*filter == NULL) {
+      Nan::ThrowTypeError(error->message);
+      g_error_free(error);
+      return false;
+    }
+  }
+
+  return true;
+}
+
 static EventsClosure* events_closure_new(guint signal_id,
-    Handle<Function> callback, Handle<Object> parent,
+    Handle<Function> callback, Handle<Object> parent, Events* owner,
     Events::TransformCallback transform, gpointer transform_data,
-    Runtime* runtime) {
-  auto isolate = Isolate::GetCurrent();
-
+    MessageFilter* filter, gboolean raw, gboolean weak, Runtime* runtime) {
   GClosure* closure = g_closure_new_simple(sizeof(EventsClosure), NULL);
   g_closure_add_finalize_notifier(closure, NULL, events_closure_finalize);
   g_closure_set_marshal(closure, events_closure_marshal);
@@ -224,10 +353,15 @@ static EventsClosure* events_closure_new(guint signal_id,
   self->alive = TRUE;
   self->signal_id = signal_id;
   self->handler_id = 0;
-  self->callback = new v8::Persistent<Function>(isolate, callback);
-  self->parent = new v8::Persistent<Object>(isolate, parent);
+  self->callback = new Nan::Persistent<Function>(callback);
+  // Weak listeners must not keep their Events object alive, so they reach
+  // it through the owner instead, which ~Events() clears.
+  self->parent = !weak ? new Nan::Persistent<Object>(parent) : NULL;
+  self->owner = owner;
   self->transform = transform;
   self->transform_data = transform_data;
+  self->filter = filter;
+  self->raw = raw;
   self->runtime = runtime;
 
   return self;
@@ -237,9 +371,12 @@ static void events_closure_finalize(gpointer data, GClosure* closure) {
   EventsClosure* self = reinterpret_cast<EventsClosure*>(closure);
 
   self->callback->Reset();
-  self->parent->Reset();
   delete self->callback;
-  delete self->parent;
+  if (self->parent != NULL) {
+    self->parent->Reset();
+    delete self->parent;
+  }
+  delete self->filter;
 }
 
 static void events_closure_marshal(GClosure* closure, GValue* return_gvalue,
@@ -247,7 +384,9 @@ static void events_closure_marshal(GClosure* closure, GValue* return_gvalue,
     gpointer marshal_data) {
   EventsClosure* self = reinterpret_cast<EventsClosure*>(closure);
 
-  g_closure_ref(closure);
+  if (self->filter != NULL &&
+      !events_closure_accepts(self, n_param_values, param_values))
+    return;
 
   GArray* args = g_array_sized_new(FALSE, FALSE, sizeof (GValue), n_param_values);
   g_assert(n_param_values >= 1);
@@ -271,9 +410,16 @@ static void events_closure_marshal(GClosure* closure, GValue* return_gvalue,
     g_array_append_val(args, val);
   }
 
+  events_closure_schedule(self, args);
+}
+
+static void events_closure_schedule(EventsClosure* self, GArray* args) {
+  auto closure = reinterpret_cast<GClosure*>(self);
+  g_closure_ref(closure);
+
   self->runtime->GetUVContext()->Schedule([=]() {
     if (self->alive) {
-      auto transform = self->transform;
+      auto transform = !self->raw ? self->transform : NULL;
       auto transform_data = self->transform_data;
       auto signal_name = g_signal_name(self->signal_id);
 
@@ -288,7 +434,9 @@ static void events_closure_marshal(GClosure* closure, GValue* return_gvalue,
           argv[i] = events_closure_gvalue_to_jsvalue(value);
       }
 
-      auto recv = Nan::New<v8::Object>(*self->parent);
+      auto recv = (self->parent != NULL)
+          ? Nan::New<v8::Object>(*self->parent)
+          : self->owner->handle();
       auto callback = Nan::New<v8::Function>(*self->callback);
       callback->Call(recv, argc, argv);
 
@@ -303,6 +451,125 @@ static void events_closure_marshal(GClosure* closure, GValue* return_gvalue,
   });
 }
 
+static gboolean events_closure_accepts(EventsClosure* self,
+    guint n_param_values, const GValue* param_values) {
+  g_assert(n_param_values >= 2);
+  auto message = g_value_get_string(&param_values[1]);
+
+  const guint8* data = NULL;
+  gint data_size = 0;
+  for (guint i = 2; i != n_param_values; i++) {
+    if (param_values[i].g_type == G_TYPE_POINTER) {
+      g_assert(n_param_values - i >= 2);
+      data = static_cast<const guint8*>(g_value_get_pointer(&param_values[i]));
+      data_size = g_value_get_int(&param_values[i + 1]);
+      break;
+    }
+  }
+
+  if (g_str_has_prefix(message, EVENTS_BATCH_PREFIX)) {
+    events_closure_deliver_batch(self, message, data, data_size);
+    return FALSE;
+  }
+
+  auto has_data = data != NULL && data_size > 0;
+  if (!self->filter->NeedsMessage())
+    return self->filter->Matches(message, has_data);
+
+  G_LOCK(events_parse_cache);
+  auto matches = self->filter->Matches(events_parse_message(message),
+      has_data);
+  G_UNLOCK(events_parse_cache);
+  return matches;
+}
+
+// Must be called with events_parse_cache held. Returns NULL for messages
+// that aren't valid JSON, which no filter needing the message matches.
+static JsonNode* events_parse_message(const gchar* message) {
+  if (events_parse_cache_message == NULL ||
+      strcmp(events_parse_cache_message, message) != 0) {
+    g_free(events_parse_cache_message);
+    g_clear_object(&events_parse_cache_parser);
+
+    events_parse_cache_message = g_strdup(message);
+    events_parse_cache_parser = json_parser_new();
+    if (!json_parser_load_from_data(events_parse_cache_parser, message, -1,
+        NULL))
+      g_clear_object(&events_parse_cache_parser);
+  }
+
+  return (events_parse_cache_parser != NULL)
+      ? json_parser_get_root(events_parse_cache_parser)
+      : NULL;
+}
+
+// A batch is ["frida:batch", [[payload, offset, length], ...]] with the
+// entries' data concatenated; length is -1 for entries without data. Each
+// entry is filtered on its own and the matching ones are delivered as
+// separate messages, just as if they had been sent unbatched.
+static void events_closure_deliver_batch(EventsClosure* self,
+    const gchar* message, const guint8* data, gint data_size) {
+  auto parser = json_parser_new();
+  if (!json_parser_load_from_data(parser, message, -1, NULL)) {
+    g_object_unref(parser);
+    return;
+  }
+
+  auto payload = json_object_get_member(
+      json_node_get_object(json_parser_get_root(parser)), "payload");
+  JsonArray* entries = NULL;
+  if (payload != NULL && JSON_NODE_HOLDS_ARRAY(payload) &&
+      json_array_get_length(json_node_get_array(payload)) == 2) {
+    auto node = json_array_get_element(json_node_get_array(payload), 1);
+    if (JSON_NODE_HOLDS_ARRAY(node))
+      entries = json_node_get_array(node);
+  }
+
+  auto generator = json_generator_new();
+  auto length = (entries != NULL) ? json_array_get_length(entries) : 0;
+  for (guint i = 0; i != length; i++) {
+    auto entry_node = json_array_get_element(entries, i);
+    if (!JSON_NODE_HOLDS_ARRAY(entry_node) ||
+        json_array_get_length(json_node_get_array(entry_node)) != 3)
+      continue;
+    auto entry = json_node_get_array(entry_node);
+    auto offset = json_array_get_int_element(entry, 1);
+    auto size = json_array_get_int_element(entry, 2);
+    auto has_data = size > 0 && offset >= 0 && offset + size <= data_size;
+
+    auto object = json_object_new();
+    json_object_set_string_member(object, "type", "send");
+    json_object_set_member(object, "payload",
+        json_node_copy(json_array_get_element(entry, 0)));
+    auto root = json_node_new(JSON_NODE_OBJECT);
+    json_node_take_object(root, object);
+
+    if (self->filter->Matches(root, has_data)) {
+      GArray* args = g_array_sized_new(FALSE, TRUE, sizeof (GValue), 2);
+      g_array_set_size(args, 2);
+
+      json_generator_set_root(generator, root);
+      auto json = &g_array_index(args, GValue, 0);
+      g_value_init(json, G_TYPE_STRING);
+      g_value_take_string(json, json_generator_to_data(generator, NULL));
+
+      auto bytes = has_data ? g_bytes_new(data + offset, size)
+          : g_bytes_new(NULL, 0);
+      auto blob = &g_array_index(args, GValue, 1);
+      g_value_init(blob, G_TYPE_VARIANT);
+      g_value_set_variant(blob,
+          g_variant_new_from_bytes(G_VARIANT_TYPE("ay"), bytes, TRUE));
+      g_bytes_unref(bytes);
+
+      events_closure_schedule(self, args);
+    }
+
+    json_node_free(root);
+  }
+  g_object_unref(generator);
+  g_object_unref(parser);
+}
+
 static void events_buffer_free(char* data, void* hint) {
   g_variant_unref (static_cast<GVariant *>(hint));
 }
@@ -5,6 +5,9 @@
 
 namespace frida {
 
+class MessageFilter;
+struct _EventsClosure;
+
 class Events : public GLibObject {
  public:
   typedef v8::Local<v8::Value>(*TransformCallback)(const gchar* name,
@@ -32,6 +35,14 @@ class Events : public GLibObject {
   bool GetSignalArguments(
       const Nan::FunctionCallbackInfo<v8::Value>& info,
       guint& signal_id, v8::Local<v8::Function>& callback);
+  bool GetListenOptions(
+      const Nan::FunctionCallbackInfo<v8::Value>& info,
+      guint signal_id, MessageFilter** filter, gboolean* raw,
+      gboolean* weak);
+  void Disconnect(GSList* link);
+
+  static void OnCallbackCollected(
+      const Nan::WeakCallbackInfo<_EventsClosure>& data);
 
   TransformCallback transform_;
   gpointer transform_data_;
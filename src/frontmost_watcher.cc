@@ -0,0 +1,215 @@
+#include "frontmost_watcher.h"
+
+#include <nan.h>
+
+#define FRONTMOST_WATCHER_DATA_CONSTRUCTOR "frontmost_watcher:ctor"
+
+using v8::External;
+using v8::Function;
+using v8::Handle;
+using v8::Integer;
+using v8::Isolate;
+using v8::Local;
+using v8::Object;
+using v8::Persistent;
+using v8::Value;
+
+namespace frida {
+
+FrontmostWatcher::FrontmostWatcher(FridaDevice* device, Runtime* runtime)
+    : GLibObject(device, runtime),
+      source_(NULL),
+      polling_(false),
+      stopped_(false),
+      has_state_(false),
+      identifier_(NULL),
+      pid_(0) {
+  g_object_ref(handle_);
+}
+
+FrontmostWatcher::~FrontmostWatcher() {
+  callback_.Reset();
+  g_free(identifier_);
+  frida_unref(handle_);
+}
+
+void FrontmostWatcher::Init(Handle<Object> exports, Runtime* runtime) {
+  auto isolate = Isolate::GetCurrent();
+
+  auto name = Nan::New("FrontmostWatcher").ToLocalChecked();
+  auto tpl = CreateTemplate(name, FrontmostWatcher::New, runtime);
+
+  Nan::SetPrototypeMethod(tpl, "stop", Stop);
+
+  auto ctor = Nan::GetFunction(tpl).ToLocalChecked();
+  Nan::Set(exports, name, ctor);
+  runtime->SetDataPointer(FRONTMOST_WATCHER_DATA_CONSTRUCTOR,
+      new Persistent<Function>(isolate, ctor));
+}
+
+Local<Object> FrontmostWatcher::New(gpointer device, guint interval,
+    Local<Function> callback, Runtime* runtime) {
+  auto ctor = Nan::New<Function>(
+      *static_cast<Persistent<Function>*>(
+      runtime->GetDataPointer(FRONTMOST_WATCHER_DATA_CONSTRUCTOR)));
+  const int argc = 1;
+  Local<Value> argv[argc] = { Nan::New<External>(device) };
+  auto obj = Nan::NewInstance(ctor, argc, argv).ToLocalChecked();
+  ObjectWrap::Unwrap<FrontmostWatcher>(obj)->Start(interval, callback);
+  return obj;
+}
+
+NAN_METHOD(FrontmostWatcher::New) {
+  if (info.IsConstructCall()) {
+    if (info.Length() != 1 || !info[0]->IsExternal()) {
+      Nan::ThrowTypeError("Bad argument, expected raw handle");
+      return;
+    }
+    auto runtime = GetRuntimeFromConstructorArgs(info);
+
+    auto device = static_cast<FridaDevice*>(
+        Local<External>::Cast(info[0])->Value());
+    auto wrapper = new FrontmostWatcher(device, runtime);
+    auto obj = info.This();
+    wrapper->Wrap(obj);
+
+    info.GetReturnValue().Set(obj);
+  } else {
+    info.GetReturnValue().Set(info.Callee()->NewInstance(0, NULL));
+  }
+}
+
+NAN_METHOD(FrontmostWatcher::Stop) {
+  auto wrapper = ObjectWrap::Unwrap<FrontmostWatcher>(info.Holder());
+
+  if (wrapper->callback_.IsEmpty())
+    return;
+  wrapper->callback_.Reset();
+
+  // Held until the GLib side has seen the stop request.
+  wrapper->Ref();
+  auto runtime = wrapper->runtime_;
+  runtime->GetGLibContext()->Schedule([=]() {
+    wrapper->stopped_ = true;
+    if (wrapper->source_ != NULL) {
+      g_source_destroy(wrapper->source_);
+      g_source_unref(wrapper->source_);
+      wrapper->source_ = NULL;
+    }
+    if (!wrapper->polling_)
+      wrapper->Finish();
+    runtime->GetUVContext()->Schedule([=]() { wrapper->Unref(); });
+  });
+}
+
+void FrontmostWatcher::Start(guint interval, Local<Function> callback) {
+  callback_.Reset(Isolate::GetCurrent(), callback);
+
+  // Keep the wrapper alive until the GLib side is done with it.
+  Ref();
+  runtime_->GetUVContext()->IncreaseUsage();
+  runtime_->GetGLibContext()->Schedule([=]() {
+    if (stopped_)
+      return;
+    source_ = g_timeout_source_new(interval);
+    g_source_set_callback(source_, OnTick, this, NULL);
+    g_source_attach(source_,
+        runtime_->GetGLibContext()->GetMainContext());
+    OnTick(this);
+  });
+}
+
+void FrontmostWatcher::Finish() {
+  runtime_->GetUVContext()->Schedule([=]() {
+    runtime_->GetUVContext()->DecreaseUsage();
+    Unref();
+  });
+}
+
+gboolean FrontmostWatcher::OnTick(gpointer user_data) {
+  auto self = static_cast<FrontmostWatcher*>(user_data);
+
+  // A slow device must not pile up requests; skip ticks until it answers.
+  if (!self->polling_) {
+    self->polling_ = true;
+    frida_device_get_frontmost_application(self->GetHandle<FridaDevice>(),
+        OnReady, self);
+  }
+
+  return TRUE;
+}
+
+void FrontmostWatcher::OnReady(GObject* source_object, GAsyncResult* result,
+    gpointer user_data) {
+  auto self = static_cast<FrontmostWatcher*>(user_data);
+
+  self->polling_ = false;
+
+  GError* error = NULL;
+  auto application = frida_device_get_frontmost_application_finish(
+      self->GetHandle<FridaDevice>(), result, &error);
+
+  if (self->stopped_) {
+    if (application != NULL)
+      g_object_unref(application);
+    g_clear_error(&error);
+    self->Finish();
+    return;
+  }
+
+  if (error != NULL) {
+    // Transient failures are retried on the next tick.
+    g_error_free(error);
+    return;
+  }
+
+  const gchar* identifier = NULL;
+  guint pid = 0;
+  if (application != NULL) {
+    identifier = frida_application_get_identifier(application);
+    pid = frida_application_get_pid(application);
+  }
+
+  bool changed = !self->has_state_ || pid != self->pid_ ||
+      g_strcmp0(identifier, self->identifier_) != 0;
+  if (changed) {
+    self->has_state_ = true;
+    g_free(self->identifier_);
+    self->identifier_ = g_strdup(identifier);
+    self->pid_ = pid;
+
+    auto copy = g_strdup(identifier);
+    self->runtime_->GetUVContext()->Schedule([=]() {
+      self->Emit(copy, pid);
+    });
+  }
+
+  if (application != NULL)
+    g_object_unref(application);
+}
+
+void FrontmostWatcher::Emit(gchar* identifier, guint pid) {
+  if (!callback_.IsEmpty()) {
+    Local<Value> application;
+    if (identifier != NULL) {
+      auto summary = Nan::New<Object>();
+      Nan::Set(summary, Nan::New("identifier").ToLocalChecked(),
+          Nan::New(identifier).ToLocalChecked());
+      Nan::Set(summary, Nan::New("pid").ToLocalChecked(),
+          Integer::NewFromUnsigned(Isolate::GetCurrent(), pid));
+      application = summary;
+    } else {
+      application = Nan::Null();
+    }
+
+    auto recv = Nan::Undefined();
+    auto callback = Nan::New<Function>(callback_);
+    const int argc = 1;
+    Local<Value> argv[argc] = { application };
+    callback->Call(recv, argc, argv);
+  }
+
+  g_free(identifier);
+}
+
+}
@@ -0,0 +1,43 @@
+#ifndef FRIDANODE_FRONTMOST_WATCHER_H
+#define FRIDANODE_FRONTMOST_WATCHER_H
+
+#include "glib_object.h"
+
+#include <frida-core.h>
+#include <nan.h>
+
+namespace frida {
+
+class FrontmostWatcher : public GLibObject {
+ public:
+  static void Init(v8::Handle<v8::Object> exports, Runtime* runtime);
+  static v8::Local<v8::Object> New(gpointer device, guint interval,
+      v8::Local<v8::Function> callback, Runtime* runtime);
+
+ private:
+  explicit FrontmostWatcher(FridaDevice* device, Runtime* runtime);
+  ~FrontmostWatcher();
+
+  static NAN_METHOD(New);
+  static NAN_METHOD(Stop);
+
+  void Start(guint interval, v8::Local<v8::Function> callback);
+  void Finish();
+
+  static gboolean OnTick(gpointer user_data);
+  static void OnReady(GObject* source_object, GAsyncResult* result,
+      gpointer user_data);
+  void Emit(gchar* identifier, guint pid);
+
+  v8::Persistent<v8::Function> callback_;
+  GSource* source_;
+  bool polling_;
+  bool stopped_;
+  bool has_state_;
+  gchar* identifier_;
+  guint pid_;
+};
+
+}
+
+#endif
@@ -17,6 +17,10 @@ GLibContext::~GLibContext() {
   g_mutex_clear(&mutex_);
 }
 
+GMainContext* GLibContext::GetMainContext() const {
+  return main_context_;
+}
+
 void GLibContext::Schedule(std::function<void ()> f) {
   auto source = g_idle_source_new();
   g_source_set_callback(source, InvokeCallback, new std::function<void ()>(f),
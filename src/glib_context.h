@@ -12,6 +12,8 @@ public:
   GLibContext(GMainContext* main_context);
   ~GLibContext();
 
+  GMainContext* GetMainContext() const;
+
   void Schedule(std::function<void ()> f);
   void Perform(std::function<void ()> f);
 
@@ -0,0 +1,387 @@
+#include "heap_walker.h"
+
+#include "host_work.h"
+
+#include <cstring>
+#include <map>
+#include <node.h>
+#include <unordered_set>
+#include <vector>
+
+#define HEAP_SNAPSHOT_MAGIC 0x50414548
+#define HEAP_SNAPSHOT_HEADER_SIZE 16
+#define HEAP_ARENA_ENTRY_SIZE 8
+#define HEAP_SEGMENT_ENTRY_SIZE 24
+#define HEAP_FREE_ENTRY_SIZE 8
+
+#define CHUNK_HEADER_SIZE 16
+#define CHUNK_MIN_SIZE 16
+#define CHUNK_ALIGNMENT 16
+#define CHUNK_PREV_INUSE 1
+#define CHUNK_FLAGS 7
+#define SMALL_CLASS_LIMIT 1024
+
+using v8::Array;
+using v8::External;
+using v8::Handle;
+using v8::Isolate;
+using v8::Local;
+using v8::Object;
+using v8::Value;
+
+namespace frida {
+
+struct HeapSegment {
+  guint64 address;
+  guint64 size;
+  guint arena;
+  // Bytes of the segment fed so far, where the next chunk header is, and
+  // the size of the chunk before it, whose in-use bit is in that header.
+  guint64 fed;
+  guint64 next;
+  guint64 pending;
+  bool done;
+};
+
+struct HeapClassStats {
+  guint64 in_use;
+  guint64 in_use_bytes;
+  guint64 free;
+  guint64 free_bytes;
+};
+
+// The state of one walk. Segments are fed in order, a piece at a time, and
+// only the position within each is carried from one piece to the next.
+class HeapWalk : public node::ObjectWrap {
+ public:
+  HeapWalk()
+    : busy_(false),
+      chunks_(0),
+      in_use_(0),
+      in_use_bytes_(0),
+      free_(0),
+      free_bytes_(0),
+      largest_free_(0),
+      top_bytes_(0),
+      truncated_(0) {
+  }
+
+  bool Parse(const guint8* table, gsize size) {
+    if (size < HEAP_SNAPSHOT_HEADER_SIZE ||
+        ReadU32(table, 0) != HEAP_SNAPSHOT_MAGIC)
+      return false;
+    guint64 arena_count = ReadU32(table, 4);
+    guint64 segment_count = ReadU32(table, 8);
+    guint64 free_count = ReadU32(table, 12);
+    gsize offset = HEAP_SNAPSHOT_HEADER_SIZE;
+    if (offset + arena_count * HEAP_ARENA_ENTRY_SIZE +
+        segment_count * HEAP_SEGMENT_ENTRY_SIZE +
+        free_count * HEAP_FREE_ENTRY_SIZE != size)
+      return false;
+
+    for (guint64 i = 0; i != arena_count; i++) {
+      tops_.push_back(ReadU64(table, offset));
+      offset += HEAP_ARENA_ENTRY_SIZE;
+    }
+
+    for (guint64 i = 0; i != segment_count; i++) {
+      HeapSegment segment;
+      segment.address = ReadU64(table, offset);
+      segment.size = ReadU64(table, offset + 8);
+      segment.arena = ReadU32(table, offset + 16);
+      segment.fed = 0;
+      segment.next = 0;
+      segment.pending = 0;
+      segment.done = segment.size < CHUNK_HEADER_SIZE;
+      if (segment.arena >= arena_count ||
+          segment.address % CHUNK_ALIGNMENT != 0)
+        return false;
+      segments_.push_back(segment);
+      offset += HEAP_SEGMENT_ENTRY_SIZE;
+    }
+
+    for (guint64 i = 0; i != free_count; i++) {
+      free_chunks_.insert(ReadU64(table, offset));
+      offset += HEAP_FREE_ENTRY_SIZE;
+    }
+
+    return true;
+  }
+
+  bool CanFeed(guint index, gsize size) const {
+    if (index >= segments_.size())
+      return false;
+    auto& segment = segments_[index];
+    if (size > segment.size - segment.fed)
+      return false;
+    // Chunk headers are aligned, so they never straddle two pieces.
+    return size % CHUNK_ALIGNMENT == 0 || size == segment.size - segment.fed;
+  }
+
+  // `data` holds the next `size` bytes of the segment.
+  void Feed(guint index, const guint8* data, gsize size) {
+    auto& segment = segments_[index];
+    auto base = segment.fed;
+    segment.fed += size;
+
+    auto top = tops_[segment.arena];
+    while (!segment.done) {
+      if (segment.size - segment.next < CHUNK_HEADER_SIZE) {
+        // The last chunk runs up to the end; nothing follows to tell
+        // whether it is in use.
+        Flush(segment, true);
+        segment.done = true;
+        break;
+      }
+      if (segment.next + CHUNK_HEADER_SIZE > segment.fed)
+        break;
+
+      auto header = ReadU64(data, segment.next - base + 8);
+      Flush(segment, (header & CHUNK_PREV_INUSE) != 0);
+
+      auto address = segment.address + segment.next;
+      auto chunk_size = header & ~static_cast<guint64>(CHUNK_FLAGS);
+      if (address == top) {
+        top_bytes_ += chunk_size;
+        segment.done = true;
+      } else if (chunk_size < CHUNK_MIN_SIZE) {
+        // The fenceposts closing a non-main heap.
+        segment.done = true;
+      } else if (chunk_size > segment.size - segment.next ||
+          chunk_size % CHUNK_ALIGNMENT != 0) {
+        // The heap changed under us while it was being read.
+        truncated_++;
+        segment.done = true;
+      } else {
+        segment.pending = chunk_size;
+        segment.next += chunk_size;
+      }
+    }
+  }
+
+  Local<Object> Summarize() const {
+    // Segments that could not be read to the end are cut short as well.
+    auto truncated = truncated_;
+    for (auto& segment : segments_) {
+      if (!segment.done)
+        truncated++;
+    }
+
+    auto result = Nan::New<Object>();
+    Set(result, "arenas", tops_.size());
+    Set(result, "segments", segments_.size());
+    Set(result, "chunks", chunks_);
+    Set(result, "inUse", in_use_);
+    Set(result, "inUseBytes", in_use_bytes_);
+    Set(result, "free", free_);
+    Set(result, "freeBytes", free_bytes_);
+    Set(result, "largestFree", largest_free_);
+    Set(result, "top", top_bytes_);
+    Set(result, "truncated", truncated);
+    Nan::Set(result, Nan::New("fragmentation").ToLocalChecked(),
+        Nan::New<v8::Number>((free_bytes_ != 0)
+            ? 1.0 - static_cast<double>(largest_free_) / free_bytes_
+            : 0.0));
+
+    auto count = static_cast<uint32_t>(classes_.size());
+    auto sizes = Nan::New<Array>(count);
+    auto in_use = Nan::New<Array>(count);
+    auto in_use_bytes = Nan::New<Array>(count);
+    auto free = Nan::New<Array>(count);
+    auto free_bytes = Nan::New<Array>(count);
+    uint32_t i = 0;
+    for (auto& entry : classes_) {
+      auto& stats = entry.second;
+      Nan::Set(sizes, i, Nan::New<v8::Number>(entry.first));
+      Nan::Set(in_use, i, Nan::New<v8::Number>(stats.in_use));
+      Nan::Set(in_use_bytes, i, Nan::New<v8::Number>(stats.in_use_bytes));
+      Nan::Set(free, i, Nan::New<v8::Number>(stats.free));
+      Nan::Set(free_bytes, i, Nan::New<v8::Number>(stats.free_bytes));
+      i++;
+    }
+    auto classes = Nan::New<Object>();
+    Nan::Set(classes, Nan::New("sizes").ToLocalChecked(), sizes);
+    Nan::Set(classes, Nan::New("inUse").ToLocalChecked(), in_use);
+    Nan::Set(classes, Nan::New("inUseBytes").ToLocalChecked(), in_use_bytes);
+    Nan::Set(classes, Nan::New("free").ToLocalChecked(), free);
+    Nan::Set(classes, Nan::New("freeBytes").ToLocalChecked(), free_bytes);
+    Nan::Set(result, Nan::New("classes").ToLocalChecked(), classes);
+
+    return result;
+  }
+
+  // Set while a piece is being walked on the threadpool.
+  bool busy_;
+
+ private:
+  void Flush(HeapSegment& segment, bool in_use) {
+    if (segment.pending == 0)
+      return;
+    auto address = segment.address + segment.next - segment.pending;
+    if (in_use && free_chunks_.count(address) != 0)
+      in_use = false;
+    Record(segment.pending, in_use);
+    segment.pending = 0;
+  }
+
+  void Record(guint64 size, bool in_use) {
+    guint64 size_class = size;
+    if (size > SMALL_CLASS_LIMIT) {
+      size_class = SMALL_CLASS_LIMIT;
+      while (size_class <= size / 2)
+        size_class *= 2;
+    }
+    auto& stats = classes_[size_class];
+
+    chunks_++;
+    if (in_use) {
+      in_use_++;
+      in_use_bytes_ += size;
+      stats.in_use++;
+      stats.in_use_bytes += size;
+    } else {
+      free_++;
+      free_bytes_ += size;
+      if (size > largest_free_)
+        largest_free_ = size;
+      stats.free++;
+      stats.free_bytes += size;
+    }
+  }
+
+  static guint32 ReadU32(const guint8* data, gsize offset) {
+    guint32 value;
+    memcpy(&value, data + offset, sizeof(value));
+    return GUINT32_FROM_LE(value);
+  }
+
+  static guint64 ReadU64(const guint8* data, gsize offset) {
+    guint64 value;
+    memcpy(&value, data + offset, sizeof(value));
+    return GUINT64_FROM_LE(value);
+  }
+
+  static void Set(Local<Object> object, const char* name, guint64 value) {
+    Nan::Set(object, Nan::New(name).ToLocalChecked(),
+        Nan::New<v8::Number>(static_cast<double>(value)));
+  }
+
+  std::vector<guint64> tops_;
+  std::vector<HeapSegment> segments_;
+  std::unordered_set<guint64> free_chunks_;
+  std::map<guint64, HeapClassStats> classes_;
+  guint64 chunks_;
+  guint64 in_use_;
+  guint64 in_use_bytes_;
+  guint64 free_;
+  guint64 free_bytes_;
+  guint64 largest_free_;
+  guint64 top_bytes_;
+  guint64 truncated_;
+};
+
+class FeedHeapWork : public HostWork {
+ public:
+  FeedHeapWork(Isolate* isolate, Local<Object> walk, guint index,
+      Local<Object> data)
+    : walk_(isolate, walk),
+      walk_wrapper_(node::ObjectWrap::Unwrap<HeapWalk>(walk)),
+      index_(index),
+      data_(isolate, data),
+      bytes_(reinterpret_cast<const guint8*>(node::Buffer::Data(data))),
+      size_(node::Buffer::Length(data)) {
+    walk_wrapper_->busy_ = true;
+  }
+
+  ~FeedHeapWork() {
+    walk_wrapper_->busy_ = false;
+    walk_.Reset();
+    data_.Reset();
+  }
+
+ protected:
+  void Execute() {
+    walk_wrapper_->Feed(index_, bytes_, size_);
+  }
+
+  Local<Value> Result(Isolate* isolate) {
+    return Nan::Undefined();
+  }
+
+ private:
+  v8::Persistent<Object> walk_;
+  HeapWalk* walk_wrapper_;
+  guint index_;
+  v8::Persistent<Object> data_;
+  const guint8* bytes_;
+  gsize size_;
+};
+
+void HeapWalker::Init(Handle<Object> exports, Runtime* runtime) {
+  auto name = Nan::New("HeapWalker").ToLocalChecked();
+  auto tpl = Nan::New<v8::FunctionTemplate>(New,
+      Nan::New<External>(runtime));
+  tpl->SetClassName(name);
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+  Nan::SetPrototypeMethod(tpl, "feed", Feed);
+  Nan::SetPrototypeMethod(tpl, "finish", Finish);
+  Nan::Set(exports, name, Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+NAN_METHOD(HeapWalker::New) {
+  if (!info.IsConstructCall()) {
+    Nan::ThrowTypeError("Use the `new` keyword to create a new instance");
+    return;
+  }
+  if (info.Length() < 1 || !node::Buffer::HasInstance(info[0])) {
+    Nan::ThrowTypeError("Bad argument, expected a heap snapshot table");
+    return;
+  }
+
+  auto walk = new HeapWalk();
+  if (!walk->Parse(reinterpret_cast<const guint8*>(node::Buffer::Data(info[0])),
+      node::Buffer::Length(info[0]))) {
+    delete walk;
+    Nan::ThrowTypeError("Invalid heap snapshot");
+    return;
+  }
+  walk->Wrap(info.This());
+  info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(HeapWalker::Feed) {
+  auto isolate = info.GetIsolate();
+  auto runtime = static_cast<Runtime*>(info.Data().As<External>()->Value());
+  auto walk = node::ObjectWrap::Unwrap<HeapWalk>(info.Holder());
+
+  if (info.Length() < 2 || !info[0]->IsUint32() ||
+      !node::Buffer::HasInstance(info[1])) {
+    Nan::ThrowTypeError("Bad argument, expected a segment index and data");
+    return;
+  }
+  auto index = info[0]->Uint32Value();
+  auto data = info[1].As<Object>();
+  if (walk->busy_) {
+    Nan::ThrowError("The previous piece is still being walked");
+    return;
+  }
+  if (!walk->CanFeed(index, node::Buffer::Length(data))) {
+    Nan::ThrowTypeError("Bad argument, data does not continue the segment");
+    return;
+  }
+
+  auto work = new FeedHeapWork(isolate, info.Holder(), index, data);
+  work->Schedule(isolate, runtime);
+  info.GetReturnValue().Set(work->GetPromise(isolate));
+}
+
+NAN_METHOD(HeapWalker::Finish) {
+  auto walk = node::ObjectWrap::Unwrap<HeapWalk>(info.Holder());
+  if (walk->busy_) {
+    Nan::ThrowError("The previous piece is still being walked");
+    return;
+  }
+  info.GetReturnValue().Set(walk->Summarize());
+}
+
+}
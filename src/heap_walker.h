@@ -0,0 +1,24 @@
+#ifndef FRIDANODE_HEAP_WALKER_H
+#define FRIDANODE_HEAP_WALKER_H
+
+#include "runtime.h"
+
+#include <nan.h>
+
+namespace frida {
+
+// Walks glibc malloc heaps read out of the target piece by piece, as the
+// pieces arrive, and summarizes their chunks. 64-bit glibc only.
+class HeapWalker {
+ public:
+  static void Init(v8::Handle<v8::Object> exports, Runtime* runtime);
+
+ private:
+  static NAN_METHOD(New);
+  static NAN_METHOD(Feed);
+  static NAN_METHOD(Finish);
+};
+
+}
+
+#endif
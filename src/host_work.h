@@ -0,0 +1,92 @@
+#ifndef FRIDANODE_HOST_WORK_H
+#define FRIDANODE_HOST_WORK_H
+
+#include "runtime.h"
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <nan.h>
+#include <node.h>
+#include <uv.h>
+
+namespace frida {
+
+// Work done entirely on the host, such as parsing or scanning data already
+// copied out of the target. Execute() runs on the libuv threadpool and must
+// not touch V8; the promise is settled on the loop thread afterwards.
+class HostWork {
+ public:
+  void Schedule(v8::Isolate* isolate, Runtime* runtime) {
+    resolver_.Reset(isolate, v8::Promise::Resolver::New(isolate));
+    runtime_ = runtime;
+    request_.data = this;
+    uv_queue_work(runtime->GetUVContext()->GetLoop(), &request_, OnExecute,
+        OnComplete);
+  }
+
+  v8::Local<v8::Promise> GetPromise(v8::Isolate* isolate) {
+    return v8::Local<v8::Promise::Resolver>::New(isolate, resolver_)->GetPromise();
+  }
+
+ protected:
+  HostWork()
+    : runtime_(NULL),
+      error_(NULL) {
+  }
+
+  virtual ~HostWork() {
+    if (error_ != NULL) {
+      g_error_free(error_);
+    }
+    resolver_.Reset();
+  }
+
+  virtual void Execute() = 0;
+  virtual v8::Local<v8::Value> Result(v8::Isolate* isolate) = 0;
+
+  Runtime* runtime_;
+  GError* error_;
+
+ private:
+  static void OnExecute(uv_work_t* request) {
+    static_cast<HostWork*>(request->data)->Execute();
+  }
+
+  static void OnComplete(uv_work_t* request, int status) {
+    auto self = static_cast<HostWork*>(request->data);
+    if (status == UV_ECANCELED && self->error_ == NULL) {
+      self->error_ = g_error_new_literal(G_IO_ERROR, G_IO_ERROR_CANCELLED,
+          "Operation was cancelled");
+    }
+
+    // We are already on the loop thread, but settling through MakeCallback()
+    // is what gets the promise reactions and nextTick queue drained.
+    Nan::HandleScope scope;
+    auto isolate = v8::Isolate::GetCurrent();
+    auto deliver = Nan::New<v8::Function>(DeliverWrapper,
+        Nan::New<v8::External>(self));
+    node::MakeCallback(isolate, Nan::New<v8::Object>(), deliver, 0, NULL);
+  }
+
+  static NAN_METHOD(DeliverWrapper) {
+    static_cast<HostWork*>(info.Data().As<v8::External>()->Value())->Deliver();
+  }
+
+  void Deliver() {
+    auto isolate = v8::Isolate::GetCurrent();
+    auto resolver = v8::Local<v8::Promise::Resolver>::New(isolate, resolver_);
+    if (error_ == NULL) {
+      resolver->Resolve(Result(isolate));
+    } else {
+      resolver->Reject(Nan::Error(error_->message));
+    }
+    delete this;
+  }
+
+  uv_work_t request_;
+  v8::Persistent<v8::Promise::Resolver> resolver_;
+};
+
+}
+
+#endif
@@ -25,6 +25,7 @@ Icon::Icon(FridaIcon* handle, Runtime* runtime)
 }
 
 Icon::~Icon() {
+  pixels_.Reset();
   g_object_unref(handle_);
 }
 
@@ -64,6 +65,19 @@ Local<Value> Icon::New(gpointer handle, Runtime* runtime) {
   return Nan::NewInstance(ctor, argc, argv).ToLocalChecked();
 }
 
+Local<Value> Icon::NewCached(v8::Persistent<Value>* cache, gpointer handle,
+    Runtime* runtime) {
+  if (cache->IsEmpty())
+    cache->Reset(Isolate::GetCurrent(), New(handle, runtime));
+  return Nan::New<v8::Value>(*cache);
+}
+
+void Icon::Load(Local<Value> icon) {
+  if (!icon->IsObject())
+    return;
+  ObjectWrap::Unwrap<Icon>(Local<Object>::Cast(icon))->GetPixelBuffer();
+}
+
 NAN_METHOD(Icon::New) {
   if (info.IsConstructCall()) {
     if (info.Length() != 1 || !info[0]->IsExternal()) {
@@ -109,14 +123,20 @@ NAN_PROPERTY_GETTER(Icon::GetRowstride) {
 }
 
 NAN_PROPERTY_GETTER(Icon::GetPixels) {
-  auto handle = ObjectWrap::Unwrap<Icon>(
-      info.Holder())->GetHandle<FridaIcon>();
+  auto wrapper = ObjectWrap::Unwrap<Icon>(info.Holder());
 
-  int len;
-  auto buf = frida_icon_get_pixels(handle, &len);
-  auto pixels = Nan::NewBuffer(reinterpret_cast<char*>(buf), len).ToLocalChecked();
+  info.GetReturnValue().Set(wrapper->GetPixelBuffer());
+}
 
-  info.GetReturnValue().Set(pixels);
+Local<Object> Icon::GetPixelBuffer() {
+  if (pixels_.IsEmpty()) {
+    int len;
+    auto buf = frida_icon_get_pixels(GetHandle<FridaIcon>(), &len);
+    auto pixels = Nan::CopyBuffer(reinterpret_cast<char*>(buf), len)
+        .ToLocalChecked();
+    pixels_.Reset(Isolate::GetCurrent(), pixels);
+  }
+  return Nan::New<v8::Object>(pixels_);
 }
 
 }
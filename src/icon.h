@@ -12,6 +12,9 @@ class Icon : public GLibObject {
  public:
   static void Init(v8::Handle<v8::Object> exports, Runtime* runtime);
   static v8::Local<v8::Value> New(gpointer handle, Runtime* runtime);
+  static v8::Local<v8::Value> NewCached(v8::Persistent<v8::Value>* cache,
+      gpointer handle, Runtime* runtime);
+  static void Load(v8::Local<v8::Value> icon);
 
  private:
   explicit Icon(FridaIcon* handle, Runtime* runtime);
@@ -24,6 +27,9 @@ class Icon : public GLibObject {
   static NAN_PROPERTY_GETTER(GetRowstride);
   static NAN_PROPERTY_GETTER(GetPixels);
 
+  v8::Local<v8::Object> GetPixelBuffer();
+
+  v8::Persistent<v8::Object> pixels_;
 };
 
 }
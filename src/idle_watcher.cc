@@ -0,0 +1,102 @@
+#include "idle_watcher.h"
+
+#include <node.h>
+
+using v8::External;
+using v8::Function;
+using v8::Handle;
+using v8::Isolate;
+using v8::Local;
+using v8::Object;
+using v8::Persistent;
+
+namespace frida {
+
+struct IdleRequest {
+  Runtime* runtime;
+  Persistent<Function> callback;
+  uv_prepare_t prepare;
+};
+
+static gboolean OnFridaIdle(gpointer user_data);
+static void OnLoopPrepare(uv_prepare_t* handle);
+static void OnLoopPrepareClosed(uv_handle_t* handle);
+
+void IdleWatcher::Init(Handle<Object> exports, Runtime* runtime) {
+  Nan::Set(exports, Nan::New("whenIdle").ToLocalChecked(),
+      Nan::GetFunction(Nan::New<v8::FunctionTemplate>(WhenIdle,
+      Nan::New<External>(runtime))).ToLocalChecked());
+}
+
+NAN_METHOD(IdleWatcher::WhenIdle) {
+  auto isolate = info.GetIsolate();
+  auto runtime = static_cast<Runtime*>(info.Data().As<External>()->Value());
+
+  if (info.Length() < 1 || !info[0]->IsFunction()) {
+    Nan::ThrowTypeError("Bad argument, expected a callback");
+    return;
+  }
+
+  auto request = new IdleRequest();
+  request->runtime = runtime;
+  request->callback.Reset(isolate, Local<Function>::Cast(info[0]));
+  request->prepare.data = request;
+
+  // Keeps the loop alive until the callback has run, as an Operation does
+  // while it is pending; the handles involved are all unref'd.
+  runtime->GetUVContext()->IncreaseUsage();
+
+  // GLibContext::Schedule() uses the default idle priority, so a source at
+  // G_PRIORITY_LOW only gets dispatched once everything we queued for the
+  // frida thread, and any I/O it has ready, has been dealt with.
+  auto glib_context = runtime->GetGLibContext();
+  glib_context->Schedule([=]() {
+    auto source = g_idle_source_new();
+    g_source_set_priority(source, G_PRIORITY_LOW);
+    g_source_set_callback(source, OnFridaIdle, request, NULL);
+    g_source_attach(source, glib_context->GetMainContext());
+    g_source_unref(source);
+  });
+}
+
+static gboolean OnFridaIdle(gpointer user_data) {
+  auto request = static_cast<IdleRequest*>(user_data);
+  auto uv_context = request->runtime->GetUVContext();
+
+  uv_context->Schedule([=]() {
+    auto handle = &request->prepare;
+    uv_prepare_init(uv_context->GetLoop(), handle);
+    uv_unref(reinterpret_cast<uv_handle_t*>(handle));
+    uv_prepare_start(handle, OnLoopPrepare);
+  });
+
+  return FALSE;
+}
+
+// Prepare handles run right before libuv polls for I/O. A non-zero poll
+// timeout means there are no expired timers, pending callbacks or active
+// idle handles (which is what setImmediate() uses), i.e. the loop is about
+// to block.
+static void OnLoopPrepare(uv_prepare_t* handle) {
+  if (uv_backend_timeout(handle->loop) == 0)
+    return;
+
+  uv_prepare_stop(handle);
+
+  Nan::HandleScope scope;
+
+  auto isolate = Isolate::GetCurrent();
+  auto request = static_cast<IdleRequest*>(handle->data);
+  auto callback = Local<Function>::New(isolate, request->callback);
+  request->callback.Reset();
+  request->runtime->GetUVContext()->DecreaseUsage();
+  uv_close(reinterpret_cast<uv_handle_t*>(handle), OnLoopPrepareClosed);
+
+  node::MakeCallback(isolate, Nan::New<Object>(), callback, 0, NULL);
+}
+
+static void OnLoopPrepareClosed(uv_handle_t* handle) {
+  delete static_cast<IdleRequest*>(handle->data);
+}
+
+}
@@ -0,0 +1,22 @@
+#ifndef FRIDANODE_IDLE_WATCHER_H
+#define FRIDANODE_IDLE_WATCHER_H
+
+#include "runtime.h"
+
+#include <nan.h>
+
+namespace frida {
+
+// Calls back once the frida thread has nothing but low-priority work left
+// and the libuv loop is about to block waiting for I/O.
+class IdleWatcher {
+ public:
+  static void Init(v8::Handle<v8::Object> exports, Runtime* runtime);
+
+ private:
+  static NAN_METHOD(WhenIdle);
+};
+
+}
+
+#endif
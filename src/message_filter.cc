@@ -0,0 +1,483 @@
+#include "message_filter.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <node.h>
+
+#define MESSAGE_FILTER_MAX_DEPTH 64
+
+using v8::External;
+using v8::Handle;
+using v8::Object;
+
+namespace frida {
+
+enum PredicateKind {
+  PREDICATE_ALL,
+  PREDICATE_ANY,
+  PREDICATE_NOT,
+  PREDICATE_TYPE,
+  PREDICATE_HAS_DATA,
+  PREDICATE_FIELD
+};
+
+struct MessageFilter::Predicate {
+  PredicateKind kind;
+  GPtrArray* children;
+  gchar* type;
+  gboolean has_data;
+  gchar** path;
+  GPtrArray* values;
+};
+
+static void predicate_value_free(gpointer data);
+static bool is_scalar(JsonNode* node);
+
+MessageFilter::MessageFilter(Predicate* root)
+    : root_(root),
+      needs_message_(PredicateNeedsMessage(root)) {
+}
+
+MessageFilter::~MessageFilter() {
+  PredicateFree(root_);
+}
+
+// Compiled once per listener, for messages that never take the native
+// delivery path on their own, such as those reassembled from fragments on
+// the host. Messages are matched as the JS values they already are.
+class MessageFilterWrapper : public node::ObjectWrap {
+ public:
+  explicit MessageFilterWrapper(MessageFilter* filter) : filter_(filter) {
+  }
+
+  ~MessageFilterWrapper() {
+    delete filter_;
+  }
+
+  MessageFilter* filter() const { return filter_; }
+
+ private:
+  MessageFilter* filter_;
+};
+
+void MessageFilter::Init(Handle<Object> exports, Runtime* runtime) {
+  auto name = Nan::New("MessageFilter").ToLocalChecked();
+  auto tpl = Nan::New<v8::FunctionTemplate>(New,
+      Nan::New<External>(runtime));
+  tpl->SetClassName(name);
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+  Nan::SetPrototypeMethod(tpl, "matches", MatchesMessage);
+  Nan::Set(exports, name, Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+NAN_METHOD(MessageFilter::New) {
+  if (!info.IsConstructCall()) {
+    Nan::ThrowTypeError("Use the `new` keyword to create a new instance");
+    return;
+  }
+  if (info.Length() < 1 || !info[0]->IsString()) {
+    Nan::ThrowTypeError("Bad argument, expected filter");
+    return;
+  }
+  Nan::Utf8String spec(info[0]);
+
+  GError* error = NULL;
+  auto filter = Compile(*spec, &error);
+  if (filter == NULL) {
+    Nan::ThrowTypeError(error->message);
+    g_error_free(error);
+    return;
+  }
+
+  auto wrapper = new MessageFilterWrapper(filter);
+  wrapper->Wrap(info.This());
+  info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(MessageFilter::MatchesMessage) {
+  if (info.Length() < 2 || !info[0]->IsObject() || !info[1]->IsBoolean()) {
+    Nan::ThrowTypeError("Bad argument, expected message and hasData");
+    return;
+  }
+  auto filter = node::ObjectWrap::Unwrap<MessageFilterWrapper>(
+      info.Holder())->filter();
+  auto has_data = info[1]->BooleanValue();
+
+  bool matches;
+  if (filter->needs_message_) {
+    auto message = ValueToNode(info[0], 0);
+    matches = filter->Matches(message, has_data);
+    if (message != NULL)
+      json_node_free(message);
+  } else {
+    matches = Evaluate(filter->root_, NULL, has_data);
+  }
+
+  info.GetReturnValue().Set(matches);
+}
+
+// Messages come from JSON.parse(), so only plain values need handling.
+// Returns NULL for values nested deeper than any sane message.
+JsonNode* MessageFilter::ValueToNode(v8::Local<v8::Value> value,
+    guint depth) {
+  if (depth == MESSAGE_FILTER_MAX_DEPTH)
+    return NULL;
+
+  auto node = json_node_alloc();
+  if (value->IsString()) {
+    json_node_init_string(node, *Nan::Utf8String(value));
+  } else if (value->IsBoolean()) {
+    json_node_init_boolean(node, value->BooleanValue());
+  } else if (value->IsNumber()) {
+    auto number = value->NumberValue();
+    if (std::floor(number) == number && std::fabs(number) <= 9007199254740992.0)
+      json_node_init_int(node, static_cast<gint64>(number));
+    else
+      json_node_init_double(node, number);
+  } else if (value->IsArray()) {
+    auto elements = v8::Local<v8::Array>::Cast(value);
+    auto length = elements->Length();
+    auto array = json_array_sized_new(length);
+    for (uint32_t i = 0; i != length; i++) {
+      auto element = ValueToNode(Nan::Get(elements, i).ToLocalChecked(),
+          depth + 1);
+      if (element == NULL)
+        element = json_node_init_null(json_node_alloc());
+      json_array_add_element(array, element);
+    }
+    json_node_init_array(node, array);
+    json_array_unref(array);
+  } else if (value->IsObject()) {
+    auto source = Nan::To<Object>(value).ToLocalChecked();
+    auto names = Nan::GetOwnPropertyNames(source).ToLocalChecked();
+    auto object = json_object_new();
+    for (uint32_t i = 0; i != names->Length(); i++) {
+      auto key = Nan::Get(names, i).ToLocalChecked();
+      auto member = ValueToNode(Nan::Get(source, key).ToLocalChecked(),
+          depth + 1);
+      if (member == NULL)
+        member = json_node_init_null(json_node_alloc());
+      json_object_set_member(object, *Nan::Utf8String(key), member);
+    }
+    json_node_init_object(node, object);
+    json_object_unref(object);
+  } else {
+    json_node_init_null(node);
+  }
+  return node;
+}
+
+MessageFilter* MessageFilter::Compile(const gchar* spec, GError** error) {
+  auto parser = json_parser_new();
+  if (!json_parser_load_from_data(parser, spec, -1, error)) {
+    g_object_unref(parser);
+    return NULL;
+  }
+
+  auto root = CompilePredicate(json_parser_get_root(parser), error);
+  g_object_unref(parser);
+  if (root == NULL)
+    return NULL;
+
+  return new MessageFilter(root);
+}
+
+bool MessageFilter::Matches(const gchar* message, gboolean has_data) const {
+  if (!needs_message_)
+    return Evaluate(root_, NULL, has_data);
+
+  auto parser = json_parser_new();
+  bool matches = false;
+  if (json_parser_load_from_data(parser, message, -1, NULL))
+    matches = Matches(json_parser_get_root(parser), has_data);
+  g_object_unref(parser);
+  return matches;
+}
+
+bool MessageFilter::Matches(JsonNode* message, gboolean has_data) const {
+  if (message == NULL || !JSON_NODE_HOLDS_OBJECT(message))
+    return false;
+  return Evaluate(root_, message, has_data);
+}
+
+MessageFilter::Predicate* MessageFilter::CompilePredicate(JsonNode* node,
+    GError** error) {
+  if (node == NULL || !JSON_NODE_HOLDS_OBJECT(node)) {
+    g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+        "Filter must be an object");
+    return NULL;
+  }
+
+  auto all = PredicateNew(PREDICATE_ALL);
+
+  auto object = json_node_get_object(node);
+  auto members = json_object_get_members(object);
+  bool valid = true;
+  for (auto cur = members; cur != NULL && valid; cur = cur->next) {
+    auto key = static_cast<const gchar*>(cur->data);
+    auto value = json_object_get_member(object, key);
+
+    if (strcmp(key, "type") == 0) {
+      if (JSON_NODE_TYPE(value) != JSON_NODE_VALUE ||
+          json_node_get_value_type(value) != G_TYPE_STRING) {
+        g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+            "Filter 'type' must be a string");
+        valid = false;
+        break;
+      }
+      auto predicate = PredicateNew(PREDICATE_TYPE);
+      predicate->type = g_strdup(json_node_get_string(value));
+      g_ptr_array_add(all->children, predicate);
+    } else if (strcmp(key, "hasData") == 0) {
+      if (JSON_NODE_TYPE(value) != JSON_NODE_VALUE ||
+          json_node_get_value_type(value) != G_TYPE_BOOLEAN) {
+        g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+            "Filter 'hasData' must be a boolean");
+        valid = false;
+        break;
+      }
+      auto predicate = PredicateNew(PREDICATE_HAS_DATA);
+      predicate->has_data = json_node_get_boolean(value);
+      g_ptr_array_add(all->children, predicate);
+    } else if (strcmp(key, "payload") == 0) {
+      if (!JSON_NODE_HOLDS_OBJECT(value)) {
+        g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+            "Filter 'payload' must be an object");
+        valid = false;
+        break;
+      }
+      auto fields = json_node_get_object(value);
+      auto paths = json_object_get_members(fields);
+      for (auto p = paths; p != NULL && valid; p = p->next) {
+        auto path = static_cast<const gchar*>(p->data);
+        auto predicate = PredicateNew(PREDICATE_FIELD);
+        g_ptr_array_add(all->children, predicate);
+        valid = CompileField(predicate, path,
+            json_object_get_member(fields, path), error);
+      }
+      g_list_free(paths);
+    } else if (strcmp(key, "all") == 0 || strcmp(key, "any") == 0) {
+      if (!JSON_NODE_HOLDS_ARRAY(value)) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+            "Filter '%s' must be an array", key);
+        valid = false;
+        break;
+      }
+      auto predicate = PredicateNew(
+          (key[1] == 'l') ? PREDICATE_ALL : PREDICATE_ANY);
+      g_ptr_array_add(all->children, predicate);
+      auto elements = json_node_get_array(value);
+      auto length = json_array_get_length(elements);
+      for (guint i = 0; i != length && valid; i++) {
+        auto child = CompilePredicate(json_array_get_element(elements, i),
+            error);
+        if (child != NULL)
+          g_ptr_array_add(predicate->children, child);
+        else
+          valid = false;
+      }
+    } else if (strcmp(key, "not") == 0) {
+      auto child = CompilePredicate(value, error);
+      if (child == NULL) {
+        valid = false;
+        break;
+      }
+      auto predicate = PredicateNew(PREDICATE_NOT);
+      g_ptr_array_add(predicate->children, child);
+      g_ptr_array_add(all->children, predicate);
+    } else {
+      g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+          "Unknown filter key '%s'", key);
+      valid = false;
+    }
+  }
+  g_list_free(members);
+
+  if (!valid) {
+    PredicateFree(all);
+    return NULL;
+  }
+
+  return all;
+}
+
+bool MessageFilter::CompileField(Predicate* predicate, const gchar* path,
+    JsonNode* node, GError** error) {
+  auto segments = g_strsplit(path, ".", -1);
+  auto n = g_strv_length(segments);
+  predicate->path = g_new0(gchar*, n + 2);
+  predicate->path[0] = g_strdup("payload");
+  for (guint i = 0; i != n; i++)
+    predicate->path[i + 1] = segments[i];
+  g_free(segments);
+
+  predicate->values = g_ptr_array_new_with_free_func(predicate_value_free);
+
+  if (JSON_NODE_HOLDS_OBJECT(node)) {
+    auto in = json_object_get_member(json_node_get_object(node), "in");
+    if (in == NULL || !JSON_NODE_HOLDS_ARRAY(in) ||
+        json_object_get_size(json_node_get_object(node)) != 1) {
+      g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+          "Filter for '%s' must be a scalar or { in: [...] }", path);
+      return false;
+    }
+    auto elements = json_node_get_array(in);
+    auto length = json_array_get_length(elements);
+    for (guint i = 0; i != length; i++) {
+      auto element = json_array_get_element(elements, i);
+      if (!is_scalar(element)) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+            "Filter values for '%s' must be scalars", path);
+        return false;
+      }
+      g_ptr_array_add(predicate->values, json_node_copy(element));
+    }
+  } else if (is_scalar(node)) {
+    g_ptr_array_add(predicate->values, json_node_copy(node));
+  } else {
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+        "Filter for '%s' must be a scalar or { in: [...] }", path);
+    return false;
+  }
+
+  return true;
+}
+
+bool MessageFilter::Evaluate(const Predicate* predicate, JsonNode* message,
+    gboolean has_data) {
+  switch (predicate->kind) {
+    case PREDICATE_ALL:
+      for (guint i = 0; i != predicate->children->len; i++) {
+        auto child = static_cast<Predicate*>(
+            g_ptr_array_index(predicate->children, i));
+        if (!Evaluate(child, message, has_data))
+          return false;
+      }
+      return true;
+    case PREDICATE_ANY:
+      for (guint i = 0; i != predicate->children->len; i++) {
+        auto child = static_cast<Predicate*>(
+            g_ptr_array_index(predicate->children, i));
+        if (Evaluate(child, message, has_data))
+          return true;
+      }
+      return false;
+    case PREDICATE_NOT:
+      return !Evaluate(static_cast<Predicate*>(
+          g_ptr_array_index(predicate->children, 0)), message, has_data);
+    case PREDICATE_TYPE: {
+      auto type = json_object_get_member(json_node_get_object(message),
+          "type");
+      return type != NULL && JSON_NODE_TYPE(type) == JSON_NODE_VALUE &&
+          json_node_get_value_type(type) == G_TYPE_STRING &&
+          strcmp(json_node_get_string(type), predicate->type) == 0;
+    }
+    case PREDICATE_HAS_DATA:
+      return (has_data != FALSE) == (predicate->has_data != FALSE);
+    case PREDICATE_FIELD: {
+      auto value = Resolve(message, predicate->path);
+      if (value == NULL)
+        return false;
+      for (guint i = 0; i != predicate->values->len; i++) {
+        auto expected = static_cast<JsonNode*>(
+            g_ptr_array_index(predicate->values, i));
+        if (ValueEquals(value, expected))
+          return true;
+      }
+      return false;
+    }
+    default:
+      g_assert_not_reached();
+  }
+}
+
+JsonNode* MessageFilter::Resolve(JsonNode* root, gchar** path) {
+  auto node = root;
+  for (auto segment = path; *segment != NULL && node != NULL; segment++) {
+    if (JSON_NODE_HOLDS_OBJECT(node)) {
+      node = json_object_get_member(json_node_get_object(node), *segment);
+    } else if (JSON_NODE_HOLDS_ARRAY(node)) {
+      gchar* end;
+      auto index = strtoul(*segment, &end, 10);
+      auto array = json_node_get_array(node);
+      if (**segment == '\0' || *end != '\0' ||
+          index >= json_array_get_length(array))
+        return NULL;
+      node = json_array_get_element(array, index);
+    } else {
+      return NULL;
+    }
+  }
+  return node;
+}
+
+bool MessageFilter::ValueEquals(JsonNode* a, JsonNode* b) {
+  if (JSON_NODE_HOLDS_NULL(a) || JSON_NODE_HOLDS_NULL(b))
+    return JSON_NODE_HOLDS_NULL(a) && JSON_NODE_HOLDS_NULL(b);
+  if (JSON_NODE_TYPE(a) != JSON_NODE_VALUE)
+    return false;
+
+  auto type_a = json_node_get_value_type(a);
+  auto type_b = json_node_get_value_type(b);
+  auto numeric_a = type_a == G_TYPE_INT64 || type_a == G_TYPE_DOUBLE;
+  auto numeric_b = type_b == G_TYPE_INT64 || type_b == G_TYPE_DOUBLE;
+  if (numeric_a && numeric_b) {
+    if (type_a == G_TYPE_INT64 && type_b == G_TYPE_INT64)
+      return json_node_get_int(a) == json_node_get_int(b);
+    return json_node_get_double(a) == json_node_get_double(b);
+  }
+  if (type_a != type_b)
+    return false;
+  if (type_a == G_TYPE_STRING)
+    return strcmp(json_node_get_string(a), json_node_get_string(b)) == 0;
+  if (type_a == G_TYPE_BOOLEAN)
+    return json_node_get_boolean(a) == json_node_get_boolean(b);
+  return false;
+}
+
+void MessageFilter::PredicateFree(gpointer data) {
+  auto predicate = static_cast<Predicate*>(data);
+  if (predicate->children != NULL)
+    g_ptr_array_unref(predicate->children);
+  if (predicate->values != NULL)
+    g_ptr_array_unref(predicate->values);
+  g_strfreev(predicate->path);
+  g_free(predicate->type);
+  g_slice_free(Predicate, predicate);
+}
+
+MessageFilter::Predicate* MessageFilter::PredicateNew(int kind) {
+  auto predicate = g_slice_new0(Predicate);
+  predicate->kind = static_cast<PredicateKind>(kind);
+  if (kind == PREDICATE_ALL || kind == PREDICATE_ANY || kind == PREDICATE_NOT)
+    predicate->children = g_ptr_array_new_with_free_func(PredicateFree);
+  return predicate;
+}
+
+bool MessageFilter::PredicateNeedsMessage(const Predicate* predicate) {
+  switch (predicate->kind) {
+    case PREDICATE_TYPE:
+    case PREDICATE_FIELD:
+      return true;
+    case PREDICATE_HAS_DATA:
+      return false;
+    default:
+      for (guint i = 0; i != predicate->children->len; i++) {
+        if (PredicateNeedsMessage(static_cast<Predicate*>(
+            g_ptr_array_index(predicate->children, i))))
+          return true;
+      }
+      return false;
+  }
+}
+
+static void predicate_value_free(gpointer data) {
+  json_node_free(static_cast<JsonNode*>(data));
+}
+
+static bool is_scalar(JsonNode* node) {
+  return JSON_NODE_TYPE(node) == JSON_NODE_VALUE || JSON_NODE_HOLDS_NULL(node);
+}
+
+}
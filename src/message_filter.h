@@ -0,0 +1,49 @@
+#ifndef FRIDANODE_MESSAGE_FILTER_H
+#define FRIDANODE_MESSAGE_FILTER_H
+
+#include "runtime.h"
+
+#include <json-glib/json-glib.h>
+#include <nan.h>
+
+namespace frida {
+
+class MessageFilter {
+ public:
+  static void Init(v8::Handle<v8::Object> exports, Runtime* runtime);
+
+  static MessageFilter* Compile(const gchar* spec, GError** error);
+  ~MessageFilter();
+
+  bool NeedsMessage() const { return needs_message_; }
+  bool Matches(const gchar* message, gboolean has_data) const;
+  bool Matches(JsonNode* message, gboolean has_data) const;
+
+ private:
+  static NAN_METHOD(New);
+  static NAN_METHOD(MatchesMessage);
+  static JsonNode* ValueToNode(v8::Local<v8::Value> value, guint depth);
+
+  struct Predicate;
+
+  explicit MessageFilter(Predicate* root);
+
+  static Predicate* PredicateNew(int kind);
+  static bool PredicateNeedsMessage(const Predicate* predicate);
+
+  static Predicate* CompilePredicate(JsonNode* node, GError** error);
+  static bool CompileField(Predicate* predicate, const gchar* path,
+      JsonNode* node, GError** error);
+  static bool Evaluate(const Predicate* predicate, JsonNode* message,
+      gboolean has_data);
+  static JsonNode* Resolve(JsonNode* root, gchar** path);
+  static bool ValueEquals(JsonNode* a, JsonNode* b);
+  static void PredicateFree(gpointer data);
+
+  Predicate* root_;
+  bool needs_message_;
+};
+
+}
+
+#endif
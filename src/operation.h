@@ -6,16 +6,58 @@
 #include <glib.h>
 #include <nan.h>
 
+#define OPERATION_ERROR g_quark_from_static_string("frida-node-operation-error")
+#define OPERATION_ERROR_ABORTED 0
+
 namespace frida {
 
+// An operation whose promise carries an abort() method. frida-core's calls
+// here take no GCancellable, so aborting only settles the promise early;
+// whatever frida-core completes afterwards is released through Discard().
+class AbortableOperation {
+ public:
+  virtual ~AbortableOperation() {
+  }
+
+  virtual void Abort(const gchar* reason) = 0;
+
+ protected:
+  static NAN_METHOD(OnAbort) {
+    auto runtime = static_cast<Runtime*>(
+        info.Data().As<v8::External>()->Value());
+    auto id = Nan::Get(info.Callee(),
+        Nan::New("operationId").ToLocalChecked()).ToLocalChecked()
+        ->Uint32Value();
+
+    auto operation = static_cast<AbortableOperation*>(
+        runtime->LookupOperation(id));
+    if (operation == NULL)
+      return;
+
+    if (info.Length() >= 1 && info[0]->IsString()) {
+      v8::String::Utf8Value reason(v8::Local<v8::String>::Cast(info[0]));
+      operation->Abort(*reason);
+    } else {
+      operation->Abort("Operation was cancelled");
+    }
+  }
+};
+
 template<class T>
-class Operation {
+class Operation : public AbortableOperation {
  public:
   void Schedule(v8::Isolate* isolate, GLibObject* parent) {
     parent_.Reset(isolate, parent->handle(isolate));
     handle_ = parent->GetHandle<T>();
     resolver_.Reset(isolate, v8::Promise::Resolver::New(isolate));
     runtime_ = parent->GetRuntime();
+    id_ = runtime_->RegisterOperation(this);
+
+    auto abort = Nan::New<v8::Function>(OnAbort,
+        Nan::New<v8::External>(runtime_));
+    Nan::Set(abort, Nan::New("operationId").ToLocalChecked(),
+        Nan::New<v8::Uint32>(id_));
+    Nan::Set(GetPromise(isolate), Nan::New("abort").ToLocalChecked(), abort);
 
     runtime_->GetUVContext()->IncreaseUsage();
     runtime_->GetGLibContext()->Schedule([=]() { Begin(); });
@@ -25,8 +67,29 @@ class Operation {
     return v8::Local<v8::Promise::Resolver>::New(isolate, resolver_)->GetPromise();
   }
 
+  void Abort(const gchar* reason) {
+    auto message = g_strdup(reason);
+    g_atomic_int_inc(&ref_count_);
+    runtime_->GetGLibContext()->Schedule([=]() {
+      if (!completed_) {
+        completed_ = true;
+        error_ = g_error_new_literal(OPERATION_ERROR, OPERATION_ERROR_ABORTED,
+            message);
+        runtime_->GetUVContext()->Schedule([=]() { Deliver(); });
+      }
+      g_free(message);
+      Unref();
+    });
+  }
+
  protected:
-  Operation() : handle_(NULL), runtime_(NULL), error_(NULL) {
+  Operation()
+    : handle_(NULL),
+      runtime_(NULL),
+      id_(0),
+      ref_count_(2),
+      completed_(false),
+      error_(NULL) {
   }
 
   virtual ~Operation() {
@@ -41,6 +104,11 @@ class Operation {
   virtual void End(GAsyncResult* result, GError** error) = 0;
   virtual v8::Local<v8::Value> Result(v8::Isolate* isolate) = 0;
 
+  // Releases whatever End() produced when the operation was cancelled
+  // before frida-core got around to completing it.
+  virtual void Discard() {
+  }
+
   static void OnReady(GObject* source_object, GAsyncResult* result, gpointer user_data) {
     static_cast<Operation<T>*>(user_data)->PerformEnd(result);
   }
@@ -52,8 +120,19 @@ class Operation {
 
  private:
   void PerformEnd(GAsyncResult* result) {
-    End(result, &error_);
-    runtime_->GetUVContext()->Schedule([=]() { Deliver(); });
+    if (completed_) {
+      GError* error = NULL;
+      End(result, &error);
+      if (error == NULL)
+        Discard();
+      else
+        g_error_free(error);
+    } else {
+      completed_ = true;
+      End(result, &error_);
+      runtime_->GetUVContext()->Schedule([=]() { Deliver(); });
+    }
+    Unref();
   }
 
   void Deliver() {
@@ -64,10 +143,20 @@ class Operation {
     } else {
       resolver->Reject(Nan::Error(error_->message));
     }
+    runtime_->UnregisterOperation(id_);
     runtime_->GetUVContext()->DecreaseUsage();
-    delete this;
+    Unref();
+  }
+
+  void Unref() {
+    if (g_atomic_int_dec_and_test(&ref_count_)) {
+      runtime_->GetUVContext()->Schedule([=]() { delete this; });
+    }
   }
 
+  guint id_;
+  volatile gint ref_count_;
+  bool completed_;
   GError* error_;
 };
 
@@ -25,6 +25,8 @@ Process::Process(FridaProcess* handle, Runtime* runtime)
 }
 
 Process::~Process() {
+  large_icon_.Reset();
+  small_icon_.Reset();
   g_object_unref(handle_);
 }
 
@@ -61,6 +63,27 @@ Local<Object> Process::New(gpointer handle, Runtime* runtime) {
   return Nan::NewInstance(ctor, argc, argv).ToLocalChecked();
 }
 
+Local<Object> Process::NewSummary(gpointer handle) {
+  auto process = static_cast<FridaProcess*>(handle);
+
+  auto summary = Nan::New<v8::Object>();
+  Nan::Set(summary, Nan::New("pid").ToLocalChecked(),
+      Nan::New<v8::Integer>(frida_process_get_pid(process)));
+  Nan::Set(summary, Nan::New("name").ToLocalChecked(),
+      Nan::New(frida_process_get_name(process)).ToLocalChecked());
+  return summary;
+}
+
+void Process::LoadIcons(Local<Object> process) {
+  auto wrapper = ObjectWrap::Unwrap<Process>(process);
+  auto handle = wrapper->GetHandle<FridaProcess>();
+
+  Icon::Load(Icon::NewCached(&wrapper->small_icon_,
+      frida_process_get_small_icon(handle), wrapper->runtime_));
+  Icon::Load(Icon::NewCached(&wrapper->large_icon_,
+      frida_process_get_large_icon(handle), wrapper->runtime_));
+}
+
 NAN_METHOD(Process::New) {
   if (info.IsConstructCall()) {
     if (info.Length() != 1 || !info[0]->IsExternal()) {
@@ -101,16 +124,16 @@ NAN_PROPERTY_GETTER(Process::GetSmallIcon) {
   auto wrapper = ObjectWrap::Unwrap<Process>(info.Holder());
   auto handle = wrapper->GetHandle<FridaProcess>();
 
-  info.GetReturnValue().Set(
-      Icon::New(frida_process_get_small_icon(handle), wrapper->runtime_));
+  info.GetReturnValue().Set(Icon::NewCached(&wrapper->small_icon_,
+      frida_process_get_small_icon(handle), wrapper->runtime_));
 }
 
 NAN_PROPERTY_GETTER(Process::GetLargeIcon) {
   auto wrapper = ObjectWrap::Unwrap<Process>(info.Holder());
   auto handle = wrapper->GetHandle<FridaProcess>();
 
-  info.GetReturnValue().Set(
-      Icon::New(frida_process_get_large_icon(handle), wrapper->runtime_));
+  info.GetReturnValue().Set(Icon::NewCached(&wrapper->large_icon_,
+      frida_process_get_large_icon(handle), wrapper->runtime_));
 }
 
 }
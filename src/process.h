@@ -11,6 +11,8 @@ class Process : public GLibObject {
  public:
   static void Init(v8::Handle<v8::Object> exports, Runtime* runtime);
   static v8::Local<v8::Object> New(gpointer handle, Runtime* runtime);
+  static v8::Local<v8::Object> NewSummary(gpointer handle);
+  static void LoadIcons(v8::Local<v8::Object> process);
 
  private:
   explicit Process(FridaProcess* handle, Runtime* runtime);
@@ -22,6 +24,9 @@ class Process : public GLibObject {
   static NAN_PROPERTY_GETTER(GetName);
   static NAN_PROPERTY_GETTER(GetSmallIcon);
   static NAN_PROPERTY_GETTER(GetLargeIcon);
+
+  v8::Persistent<v8::Value> small_icon_;
+  v8::Persistent<v8::Value> large_icon_;
 };
 
 }
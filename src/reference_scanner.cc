@@ -0,0 +1,170 @@
+#include "reference_scanner.h"
+
+#include "host_work.h"
+
+#include <algorithm>
+#include <cstring>
+#include <node.h>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+# include <emmintrin.h>
+# define HAVE_SSE2 1
+#endif
+
+using v8::External;
+using v8::Handle;
+using v8::Isolate;
+using v8::Local;
+using v8::Object;
+using v8::Value;
+
+namespace frida {
+
+typedef std::pair<guint64, guint64> AddressInterval;
+
+class FindReferencesWork : public HostWork {
+ public:
+  FindReferencesWork(Isolate* isolate, Local<Object> chunk, guint64 address,
+      std::vector<AddressInterval>&& intervals)
+    : chunk_(isolate, chunk),
+      data_(reinterpret_cast<const guint8*>(node::Buffer::Data(chunk))),
+      size_(node::Buffer::Length(chunk)),
+      address_(address),
+      intervals_(std::move(intervals)) {
+  }
+
+  ~FindReferencesWork() {
+    chunk_.Reset();
+  }
+
+ protected:
+  void Execute() {
+    if (intervals_.empty())
+      return;
+    Prepare();
+
+    auto count = size_ / 8;
+    gsize i = 0;
+
+#ifdef HAVE_SSE2
+    // Filter four words at a time on their upper halves, which for real
+    // pointers rarely match those of unrelated data, and only check the
+    // survivors precisely. SSE2 lacks unsigned compares, so both sides are
+    // biased into signed range first.
+    auto bias = _mm_set1_epi32(static_cast<int>(0x80000000));
+    auto low = _mm_set1_epi32(static_cast<int>(min_ >> 32));
+    auto span = _mm_xor_si128(
+        _mm_set1_epi32(static_cast<int>((max_ >> 32) - (min_ >> 32))), bias);
+    for (; i + 4 <= count; i += 4) {
+      auto a = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(data_ + i * 8));
+      auto b = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(data_ + i * 8 + 16));
+      auto high = _mm_unpackhi_epi64(
+          _mm_shuffle_epi32(a, _MM_SHUFFLE(3, 1, 2, 0)),
+          _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 1, 2, 0)));
+      auto offset = _mm_xor_si128(_mm_sub_epi32(high, low), bias);
+      auto outside = _mm_cmpgt_epi32(offset, span);
+      if (_mm_movemask_epi8(outside) == 0xffff)
+        continue;
+      for (gsize j = i; j != i + 4; j++)
+        Check(j);
+    }
+#endif
+
+    for (; i != count; i++)
+      Check(i);
+  }
+
+  Local<Value> Result(Isolate* isolate) {
+    return Nan::CopyBuffer(reinterpret_cast<const char*>(matches_.data()),
+        matches_.size() * sizeof(guint64)).ToLocalChecked();
+  }
+
+ private:
+  // Sorts and merges the intervals so that a lookup is one binary search.
+  void Prepare() {
+    std::sort(intervals_.begin(), intervals_.end());
+    std::vector<AddressInterval> merged;
+    for (auto& interval : intervals_) {
+      if (!merged.empty() && interval.first <= merged.back().second)
+        merged.back().second = std::max(merged.back().second, interval.second);
+      else
+        merged.push_back(interval);
+    }
+    intervals_.swap(merged);
+    min_ = intervals_.front().first;
+    max_ = intervals_.back().second - 1;
+  }
+
+  void Check(gsize index) {
+    guint64 value;
+    memcpy(&value, data_ + index * 8, sizeof(value));
+    value = GUINT64_FROM_LE(value);
+    if (value < min_ || value > max_)
+      return;
+    auto upper = std::upper_bound(intervals_.begin(), intervals_.end(),
+        AddressInterval(value, G_MAXUINT64));
+    if (upper == intervals_.begin() || value >= (upper - 1)->second)
+      return;
+    matches_.push_back(GUINT64_TO_LE(address_ + index * 8));
+    matches_.push_back(GUINT64_TO_LE(value));
+  }
+
+  v8::Persistent<Object> chunk_;
+  const guint8* data_;
+  gsize size_;
+  guint64 address_;
+  std::vector<AddressInterval> intervals_;
+  guint64 min_;
+  guint64 max_;
+  std::vector<guint64> matches_;
+};
+
+void ReferenceScanner::Init(Handle<Object> exports, Runtime* runtime) {
+  auto name = Nan::New("findReferences").ToLocalChecked();
+  auto tpl = Nan::New<v8::FunctionTemplate>(FindReferences,
+      Nan::New<External>(runtime));
+  Nan::Set(exports, name, Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+NAN_METHOD(ReferenceScanner::FindReferences) {
+  auto isolate = info.GetIsolate();
+  auto runtime = static_cast<Runtime*>(info.Data().As<External>()->Value());
+
+  if (info.Length() < 3 || !node::Buffer::HasInstance(info[0]) ||
+      !info[1]->IsString() || !node::Buffer::HasInstance(info[2])) {
+    Nan::ThrowTypeError("Bad argument, expected a chunk, its address and "
+        "target intervals");
+    return;
+  }
+  auto chunk = Local<Object>::Cast(info[0]);
+  Nan::Utf8String address(info[1]);
+  auto address_value = g_ascii_strtoull(*address, NULL, 0);
+  if (address_value % 8 != 0) {
+    Nan::ThrowTypeError("Bad argument, chunk address must be 8-byte aligned");
+    return;
+  }
+
+  auto packed = node::Buffer::Data(info[2]);
+  auto packed_size = node::Buffer::Length(info[2]);
+  std::vector<AddressInterval> intervals;
+  for (gsize offset = 0; offset + 16 <= packed_size; offset += 16) {
+    guint64 start, end;
+    memcpy(&start, packed + offset, sizeof(start));
+    memcpy(&end, packed + offset + 8, sizeof(end));
+    start = GUINT64_FROM_LE(start);
+    end = GUINT64_FROM_LE(end);
+    if (end > start)
+      intervals.push_back(AddressInterval(start, end));
+  }
+
+  auto work = new FindReferencesWork(isolate, chunk, address_value,
+      std::move(intervals));
+  work->Schedule(isolate, runtime);
+  info.GetReturnValue().Set(work->GetPromise(isolate));
+}
+
+}
@@ -0,0 +1,22 @@
+#ifndef FRIDANODE_REFERENCE_SCANNER_H
+#define FRIDANODE_REFERENCE_SCANNER_H
+
+#include "runtime.h"
+
+#include <nan.h>
+
+namespace frida {
+
+// Conservatively scans chunks of target memory for aligned 64-bit words
+// that fall inside any of a set of address intervals.
+class ReferenceScanner {
+ public:
+  static void Init(v8::Handle<v8::Object> exports, Runtime* runtime);
+
+ private:
+  static NAN_METHOD(FindReferences);
+};
+
+}
+
+#endif
@@ -15,7 +15,9 @@ namespace frida {
 Runtime::Runtime(UVContext* uv_context, GLibContext* glib_context)
   : uv_context_(uv_context),
     glib_context_(glib_context),
-    data_(g_hash_table_new_full(g_str_hash, g_str_equal, NULL, NULL)) {
+    data_(g_hash_table_new_full(g_str_hash, g_str_equal, NULL, NULL)),
+    operations_(g_hash_table_new(NULL, NULL)),
+    next_operation_id_(1) {
   auto isolate = Isolate::GetCurrent();
   auto global = isolate->GetCurrentContext()->Global();
   auto json_module = Local<Object>::Cast(
@@ -36,6 +38,7 @@ Runtime::~Runtime() {
   json_stringify_.Reset();
   json_module_.Reset();
 
+  g_hash_table_unref(operations_);
   g_hash_table_unref(data_);
 
   delete glib_context_;
@@ -58,6 +61,20 @@ void Runtime::SetDataPointer(const char* id, void* value) {
   g_hash_table_insert(data_, const_cast<char*>(id), value);
 }
 
+guint Runtime::RegisterOperation(void* operation) {
+  auto id = next_operation_id_++;
+  g_hash_table_insert(operations_, GUINT_TO_POINTER(id), operation);
+  return id;
+}
+
+void* Runtime::LookupOperation(guint id) {
+  return g_hash_table_lookup(operations_, GUINT_TO_POINTER(id));
+}
+
+void Runtime::UnregisterOperation(guint id) {
+  g_hash_table_remove(operations_, GUINT_TO_POINTER(id));
+}
+
 Local<String> Runtime::ValueToJson(Handle<Value> value) {
   auto module = Nan::New<v8::Object>(json_module_);
   auto stringify = Nan::New<v8::Function>(json_stringify_);
@@ -19,6 +19,10 @@ class Runtime {
   void* GetDataPointer(const char* id);
   void SetDataPointer(const char* id, void* value);
 
+  guint RegisterOperation(void* operation);
+  void* LookupOperation(guint id);
+  void UnregisterOperation(guint id);
+
   v8::Local<v8::String> ValueToJson(v8::Handle<v8::Value> value);
   v8::Local<v8::Value> ValueFromJson(v8::Handle<v8::String> json);
 
@@ -27,6 +31,8 @@ class Runtime {
   GLibContext* glib_context_;
 
   GHashTable* data_;
+  GHashTable* operations_;
+  guint next_operation_id_;
 
   v8::Persistent<v8::Object> json_module_;
   v8::Persistent<v8::Function> json_stringify_;
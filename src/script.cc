@@ -21,8 +21,17 @@ using v8::Value;
 
 namespace frida {
 
+typedef struct _PostRequest PostRequest;
+
+struct _PostRequest {
+  Script* script;
+  gchar* message;
+  guint tag;
+};
+
 Script::Script(FridaScript* handle, Runtime* runtime)
-    : GLibObject(handle, runtime) {
+    : GLibObject(handle, runtime),
+      pending_posts_(0) {
   g_object_ref(handle_);
 }
 
@@ -40,6 +49,7 @@ void Script::Init(Handle<Object> exports, Runtime* runtime) {
   Nan::SetPrototypeMethod(tpl, "load", Load);
   Nan::SetPrototypeMethod(tpl, "unload", Unload);
   Nan::SetPrototypeMethod(tpl, "postMessage", PostMessage);
+  Nan::SetPrototypeMethod(tpl, "post", Post);
 
   auto ctor = Nan::GetFunction(tpl).ToLocalChecked();
   Nan::Set(exports, name, ctor);
@@ -177,6 +187,93 @@ NAN_METHOD(Script::PostMessage) {
   info.GetReturnValue().Set(operation->GetPromise(isolate));
 }
 
+// Fire-and-forget variant of PostMessage: no promise, and no hop back to
+// Node unless the post fails or the last outstanding post completes. The
+// wrapper is kept alive for as long as any posts are in flight. An optional
+// non-zero tag is handed back with the error so the caller can tell which
+// post failed.
+NAN_METHOD(Script::Post) {
+  auto wrapper = ObjectWrap::Unwrap<Script>(info.Holder());
+  auto runtime = wrapper->runtime_;
+
+  if (info.Length() < 1) {
+    Nan::ThrowTypeError("Expected value serializable to JSON");
+    return;
+  }
+
+  String::Utf8Value message(runtime->ValueToJson(info[0]));
+  guint tag = (info.Length() >= 2 && info[1]->IsUint32())
+      ? info[1]->Uint32Value() : 0;
+
+  auto request = g_slice_new(PostRequest);
+  request->script = wrapper;
+  request->message = g_strdup(*message);
+  request->tag = tag;
+
+  if (g_atomic_int_add(&wrapper->pending_posts_, 1) == 0) {
+    wrapper->Ref();
+    runtime->GetUVContext()->IncreaseUsage();
+  }
+
+  auto handle = wrapper->GetHandle<FridaScript>();
+  runtime->GetGLibContext()->Schedule([=]() {
+    frida_script_post_message(handle, request->message, OnPostReady,
+        request);
+  });
+}
+
+void Script::OnPostReady(GObject* source_object, GAsyncResult* result,
+    gpointer user_data) {
+  auto request = static_cast<PostRequest*>(user_data);
+  auto wrapper = request->script;
+  auto runtime = wrapper->runtime_;
+
+  GError* error = NULL;
+  frida_script_post_message_finish(wrapper->GetHandle<FridaScript>(), result,
+      &error);
+  auto tag = request->tag;
+  g_free(request->message);
+  g_slice_free(PostRequest, request);
+
+  gchar* error_message = NULL;
+  if (error != NULL) {
+    error_message = g_strdup(error->message);
+    g_error_free(error);
+  }
+
+  bool idle = g_atomic_int_dec_and_test(&wrapper->pending_posts_);
+  if (error_message == NULL && !idle)
+    return;
+
+  runtime->GetUVContext()->Schedule([=]() {
+    if (error_message != NULL) {
+      wrapper->EmitPostError(error_message, tag);
+      g_free(error_message);
+    }
+    if (idle) {
+      runtime->GetUVContext()->DecreaseUsage();
+      wrapper->Unref();
+    }
+  });
+}
+
+void Script::EmitPostError(const gchar* message, guint tag) {
+  auto isolate = Isolate::GetCurrent();
+  auto obj = handle(isolate);
+  auto callback = Nan::Get(obj,
+      Nan::New("_onPostError").ToLocalChecked()).ToLocalChecked();
+  if (!callback->IsFunction())
+    return;
+
+  Local<Value> tag_value = Nan::Undefined();
+  if (tag != 0)
+    tag_value = Nan::New<v8::Uint32>(tag);
+
+  const int argc = 2;
+  Local<Value> argv[argc] = { Nan::Error(message), tag_value };
+  Local<Function>::Cast(callback)->Call(obj, argc, argv);
+}
+
 Local<Value> Script::TransformMessageEvent(const gchar* name, guint index,
     const GValue* value, gpointer user_data) {
   if (index != 0 || strcmp(name, "message") != 0)
@@ -22,11 +22,17 @@ class Script : public GLibObject {
   static NAN_METHOD(Load);
   static NAN_METHOD(Unload);
   static NAN_METHOD(PostMessage);
+  static NAN_METHOD(Post);
+
+  static void OnPostReady(GObject* source_object, GAsyncResult* result,
+      gpointer user_data);
+  void EmitPostError(const gchar* message, guint tag);
 
   static v8::Local<v8::Value> TransformMessageEvent(const gchar* name,
       guint index, const GValue* value, gpointer user_data);
 
   v8::Persistent<v8::Object> events_;
+  volatile gint pending_posts_;
 };
 
 }
@@ -152,6 +152,11 @@ class CreateScriptOperation : public Operation<FridaSession> {
     return wrapper;
   }
 
+  void Discard() {
+    frida_script_unload(script_, NULL, NULL);
+    g_object_unref(script_);
+  }
+
   gchar* name_;
   gchar* source_;
   FridaScript* script_;
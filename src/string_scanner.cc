@@ -0,0 +1,249 @@
+#include "string_scanner.h"
+
+#include "host_work.h"
+
+#include <algorithm>
+#include <cstring>
+#include <node.h>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+# include <emmintrin.h>
+# define HAVE_SSE2 1
+#endif
+
+#define STRING_ENCODING_ASCII 1
+#define STRING_ENCODING_UTF16LE 2
+
+using v8::External;
+using v8::Handle;
+using v8::Isolate;
+using v8::Local;
+using v8::Object;
+using v8::Value;
+
+namespace frida {
+
+struct StringMatch {
+  guint32 offset;
+  guint32 size;
+  guint32 encoding;
+
+  bool operator<(const StringMatch& other) const {
+    return offset < other.offset;
+  }
+};
+
+class ExtractStringsWork : public HostWork {
+ public:
+  ExtractStringsWork(Isolate* isolate, Local<Object> chunk, guint min_length,
+      guint encodings, bool final)
+    : chunk_(isolate, chunk),
+      data_(reinterpret_cast<const guint8*>(node::Buffer::Data(chunk))),
+      size_(node::Buffer::Length(chunk)),
+      min_length_(std::max(min_length, 1U)),
+      encodings_(encodings),
+      final_(final),
+      resume_(size_) {
+  }
+
+  ~ExtractStringsWork() {
+    chunk_.Reset();
+  }
+
+ protected:
+  void Execute() {
+    ComputeMasks();
+
+    if ((encodings_ & STRING_ENCODING_ASCII) != 0)
+      FindRuns(printable_, 1, 0, STRING_ENCODING_ASCII);
+
+    if ((encodings_ & STRING_ENCODING_UTF16LE) != 0) {
+      // A UTF-16LE character is a printable byte followed by a zero byte.
+      std::vector<guint64> characters(printable_.size());
+      for (gsize i = 0; i != characters.size(); i++) {
+        auto next_zero = (i + 1 != zero_.size()) ? zero_[i + 1] : 0;
+        characters[i] = printable_[i] & ((zero_[i] >> 1) | (next_zero << 63));
+      }
+      FindRuns(characters, 2, 0, STRING_ENCODING_UTF16LE);
+      FindRuns(characters, 2, 1, STRING_ENCODING_UTF16LE);
+    }
+
+    std::sort(matches_.begin(), matches_.end());
+
+    // A match straddling the resume point would come back cut in two, so
+    // move the resume point to its start. Everything from there on is
+    // found again by the next chunk.
+    for (auto match = matches_.rbegin(); match != matches_.rend(); ++match) {
+      if (match->offset != 0 && match->offset < resume_ &&
+          match->offset + match->size > resume_)
+        resume_ = match->offset;
+    }
+
+    // Always make progress, even on a chunk too small to hold a single
+    // character.
+    if (resume_ == 0 && size_ != 0)
+      resume_ = 1;
+
+    auto resume = resume_;
+    matches_.erase(std::remove_if(matches_.begin(), matches_.end(),
+        [=](const StringMatch& match) { return match.offset >= resume; }),
+        matches_.end());
+  }
+
+  // The first word is where the next chunk should start, so that a run cut
+  // off by the end of this one is found again whole; then come offset, size
+  // and encoding triples.
+  Local<Value> Result(Isolate* isolate) {
+    std::vector<guint32> packed;
+    packed.reserve(1 + matches_.size() * 3);
+    packed.push_back(GUINT32_TO_LE(static_cast<guint32>(resume_)));
+    for (auto& match : matches_) {
+      packed.push_back(GUINT32_TO_LE(match.offset));
+      packed.push_back(GUINT32_TO_LE(match.size));
+      packed.push_back(GUINT32_TO_LE(match.encoding));
+    }
+    return Nan::CopyBuffer(reinterpret_cast<const char*>(packed.data()),
+        packed.size() * sizeof(guint32)).ToLocalChecked();
+  }
+
+ private:
+  // Builds one bit per byte: printable (tab or 0x20-0x7e) and zero.
+  void ComputeMasks() {
+    auto words = (size_ + 63) / 64;
+    printable_.assign(words, 0);
+    zero_.assign(words, 0);
+
+    gsize offset = 0;
+#ifdef HAVE_SSE2
+    auto space = _mm_set1_epi8(0x1f);
+    auto del = _mm_set1_epi8(0x7f);
+    auto tab = _mm_set1_epi8(0x09);
+    auto nul = _mm_setzero_si128();
+    for (; offset + 64 <= size_; offset += 64) {
+      guint64 printable = 0;
+      guint64 zero = 0;
+      for (guint lane = 0; lane != 4; lane++) {
+        auto bytes = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(data_ + offset + lane * 16));
+        // Bytes of 0x80 and up are negative as signed, so they fail the
+        // lower bound.
+        auto is_printable = _mm_or_si128(
+            _mm_and_si128(_mm_cmpgt_epi8(bytes, space),
+                _mm_cmplt_epi8(bytes, del)),
+            _mm_cmpeq_epi8(bytes, tab));
+        printable |= static_cast<guint64>(static_cast<guint16>(
+            _mm_movemask_epi8(is_printable))) << (lane * 16);
+        zero |= static_cast<guint64>(static_cast<guint16>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, nul)))) << (lane * 16);
+      }
+      printable_[offset / 64] = printable;
+      zero_[offset / 64] = zero;
+    }
+#endif
+
+    for (; offset != size_; offset++) {
+      auto byte = data_[offset];
+      auto bit = static_cast<guint64>(1) << (offset % 64);
+      if ((byte >= 0x20 && byte < 0x7f) || byte == 0x09)
+        printable_[offset / 64] |= bit;
+      if (byte == 0)
+        zero_[offset / 64] |= bit;
+    }
+  }
+
+  // Collects runs of set bits at positions phase, phase + step, ... where
+  // each bit marks a character `step` bytes wide. Whole words of zeros or
+  // ones are skipped over.
+  void FindRuns(const std::vector<guint64>& mask, guint step, guint phase,
+      guint32 encoding) {
+    const gsize none = G_MAXSIZE;
+    gsize start = none;
+    gsize i = phase;
+    while (i + step <= size_) {
+      auto word = mask[i / 64];
+      if ((start == none && word == 0) ||
+          (start != none && word == G_MAXUINT64)) {
+        i = (i / 64 + 1) * 64 + phase;
+        continue;
+      }
+
+      bool set = ((word >> (i % 64)) & 1) != 0;
+      if (set && start == none) {
+        start = i;
+      } else if (!set && start != none) {
+        Emit(start, i - start, step, encoding);
+        start = none;
+      }
+      i += step;
+    }
+
+    if (start == none) {
+      // A character cut in half by the end of the chunk may start a run.
+      if (!final_ && i < size_ && ((printable_[i / 64] >> (i % 64)) & 1) != 0)
+        resume_ = std::min<gsize>(resume_, i);
+      return;
+    }
+    if (final_ || start < step) {
+      Emit(start, std::min<gsize>(i, size_) - start, step, encoding);
+    } else {
+      resume_ = std::min<gsize>(resume_, start);
+    }
+  }
+
+  void Emit(gsize start, gsize size, guint step, guint32 encoding) {
+    size -= size % step;
+    if (size / step < min_length_)
+      return;
+    StringMatch match;
+    match.offset = static_cast<guint32>(start);
+    match.size = static_cast<guint32>(size);
+    match.encoding = encoding;
+    matches_.push_back(match);
+  }
+
+  v8::Persistent<Object> chunk_;
+  const guint8* data_;
+  gsize size_;
+  guint min_length_;
+  guint encodings_;
+  bool final_;
+  gsize resume_;
+  std::vector<guint64> printable_;
+  std::vector<guint64> zero_;
+  std::vector<StringMatch> matches_;
+};
+
+void StringScanner::Init(Handle<Object> exports, Runtime* runtime) {
+  auto name = Nan::New("extractStrings").ToLocalChecked();
+  auto tpl = Nan::New<v8::FunctionTemplate>(ExtractStrings,
+      Nan::New<External>(runtime));
+  Nan::Set(exports, name, Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+NAN_METHOD(StringScanner::ExtractStrings) {
+  auto isolate = info.GetIsolate();
+  auto runtime = static_cast<Runtime*>(info.Data().As<External>()->Value());
+
+  if (info.Length() < 4 || !node::Buffer::HasInstance(info[0]) ||
+      !info[1]->IsNumber() || !info[2]->IsNumber() || !info[3]->IsBoolean()) {
+    Nan::ThrowTypeError("Bad argument, expected a chunk, a minimum length, "
+        "encodings and whether the chunk is final");
+    return;
+  }
+  auto chunk = Local<Object>::Cast(info[0]);
+  if (node::Buffer::Length(chunk) > G_MAXUINT32) {
+    Nan::ThrowTypeError("Bad argument, chunk is too large");
+    return;
+  }
+  auto min_length = info[1]->Uint32Value();
+  auto encodings = info[2]->Uint32Value();
+  auto final = info[3]->BooleanValue();
+
+  auto work = new ExtractStringsWork(isolate, chunk, min_length, encodings,
+      final);
+  work->Schedule(isolate, runtime);
+  info.GetReturnValue().Set(work->GetPromise(isolate));
+}
+
+}
@@ -0,0 +1,22 @@
+#ifndef FRIDANODE_STRING_SCANNER_H
+#define FRIDANODE_STRING_SCANNER_H
+
+#include "runtime.h"
+
+#include <nan.h>
+
+namespace frida {
+
+// Finds runs of printable ASCII and UTF-16LE characters in chunks of target
+// memory.
+class StringScanner {
+ public:
+  static void Init(v8::Handle<v8::Object> exports, Runtime* runtime);
+
+ private:
+  static NAN_METHOD(ExtractStrings);
+};
+
+}
+
+#endif
@@ -0,0 +1,286 @@
+#include "unwinder.h"
+
+#include "eh_frame.h"
+#include "host_work.h"
+
+#include <algorithm>
+#include <cstring>
+#include <gio/gio.h>
+#include <node.h>
+#include <string>
+#include <vector>
+
+#define STACK_CAPTURE_MAGIC 0x4b545346
+#define STACK_CAPTURE_ARCH_X64 1
+#define STACK_CAPTURE_HEADER_SIZE 160
+
+using v8::Array;
+using v8::External;
+using v8::Function;
+using v8::Handle;
+using v8::Isolate;
+using v8::Local;
+using v8::Object;
+using v8::Value;
+
+namespace frida {
+
+struct UnwindModule {
+  std::string path;
+  std::string build_id;
+  guint64 base;
+  guint64 size;
+
+  bool operator<(const UnwindModule& other) const {
+    return base < other.base;
+  }
+};
+
+static GMutex eh_frame_cache_mutex;
+static GHashTable* eh_frame_cache = NULL;
+
+// Parsed images are kept for the lifetime of the process; failures are
+// cached too so that modules without unwind info are only probed once.
+// The file on disk may not be what the target has loaded, e.g. after a
+// package upgrade, so images are keyed by path and the build-id seen in
+// the target, and one whose own build-id differs counts as a failure.
+static const EhFrame* eh_frame_cache_get(const UnwindModule& module) {
+  EhFrame* eh_frame;
+
+  auto key = module.path;
+  key += '\0';
+  key += module.build_id;
+
+  g_mutex_lock(&eh_frame_cache_mutex);
+  if (eh_frame_cache == NULL)
+    eh_frame_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+        NULL);
+  gpointer value;
+  if (g_hash_table_lookup_extended(eh_frame_cache, key.c_str(), NULL,
+      &value)) {
+    eh_frame = static_cast<EhFrame*>(value);
+  } else {
+    eh_frame = EhFrame::Load(module.path.c_str(), NULL);
+    if (eh_frame != NULL && !module.build_id.empty() &&
+        eh_frame->GetBuildId() != module.build_id) {
+      delete eh_frame;
+      eh_frame = NULL;
+    }
+    g_hash_table_insert(eh_frame_cache, g_strdup(key.c_str()), eh_frame);
+  }
+  g_mutex_unlock(&eh_frame_cache_mutex);
+
+  return eh_frame;
+}
+
+class UnwindStackWork : public HostWork {
+ public:
+  UnwindStackWork(const char* blob, size_t blob_size,
+      std::vector<UnwindModule>&& modules, guint max_frames)
+    : blob_(blob, blob + blob_size),
+      modules_(std::move(modules)),
+      max_frames_(max_frames) {
+    std::sort(modules_.begin(), modules_.end());
+  }
+
+ protected:
+  void Execute() {
+    if (blob_.size() < STACK_CAPTURE_HEADER_SIZE ||
+        ReadU32(0) != STACK_CAPTURE_MAGIC) {
+      g_set_error_literal(&error_, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+          "Invalid stack capture");
+      return;
+    }
+    if (ReadU32(4) != STACK_CAPTURE_ARCH_X64) {
+      g_set_error_literal(&error_, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+          "Only x86-64 stacks can be unwound");
+      return;
+    }
+
+    guint64 regs[CFI_X64_REGISTER_COUNT];
+    for (guint i = 0; i != CFI_X64_REGISTER_COUNT; i++)
+      regs[i] = ReadU64(8 + i * 8);
+    stack_base_ = ReadU64(144);
+    stack_size_ = std::min<guint64>(ReadU32(152),
+        blob_.size() - STACK_CAPTURE_HEADER_SIZE);
+
+    frames_.push_back(regs[CFI_X64_RA]);
+    while (frames_.size() < max_frames_) {
+      auto sp = regs[CFI_X64_RSP];
+      if (!Step(regs, frames_.size() == 1))
+        break;
+      if (regs[CFI_X64_RA] == 0 || regs[CFI_X64_RSP] <= sp)
+        break;
+      frames_.push_back(regs[CFI_X64_RA]);
+    }
+  }
+
+  Local<Value> Result(Isolate* isolate) {
+    return Nan::CopyBuffer(reinterpret_cast<const char*>(frames_.data()),
+        frames_.size() * sizeof(guint64)).ToLocalChecked();
+  }
+
+ private:
+  // Moves regs from one frame to its caller, with regs[CFI_X64_RA] holding
+  // the pc. Return addresses point past the call, so callers are looked up
+  // at pc - 1.
+  bool Step(guint64* regs, bool innermost) {
+    auto pc = regs[CFI_X64_RA];
+    auto lookup = innermost ? pc : pc - 1;
+
+    auto module = FindModule(lookup);
+    if (module != NULL) {
+      auto eh_frame = eh_frame_cache_get(*module);
+      CfiRow row;
+      if (eh_frame != NULL) {
+        auto bias = module->base - eh_frame->GetLoadAddress();
+        if (eh_frame->FindRow(lookup - bias, &row)) {
+          // A CFA we cannot compute, e.g. a DWARF expression, ends the
+          // walk: such frames rarely keep rbp as a frame pointer, so the
+          // fallback below would only make up callers.
+          if (!row.cfa_valid || row.cfa_register >= CFI_X64_REGISTER_COUNT)
+            return false;
+          return ApplyRow(row, regs);
+        }
+      }
+    }
+
+    // No CFI covers this pc; assume a conventional rbp frame chain.
+    auto fp = regs[CFI_X64_RBP];
+    guint64 saved_fp, return_address;
+    if (!ReadStack(fp, &saved_fp) || !ReadStack(fp + 8, &return_address))
+      return false;
+    regs[CFI_X64_RBP] = saved_fp;
+    regs[CFI_X64_RSP] = fp + 16;
+    regs[CFI_X64_RA] = return_address;
+    return true;
+  }
+
+  bool ApplyRow(const CfiRow& row, guint64* regs) {
+    guint64 caller[CFI_X64_REGISTER_COUNT];
+    auto cfa = regs[row.cfa_register] + row.cfa_offset;
+
+    for (guint i = 0; i != CFI_X64_REGISTER_COUNT; i++) {
+      auto& rule = row.rules[i];
+      switch (rule.kind) {
+        case CFI_RULE_UNDEFINED:
+          if (i == CFI_X64_RA)
+            return false;
+          caller[i] = 0;
+          break;
+        case CFI_RULE_SAME_VALUE:
+          caller[i] = regs[i];
+          break;
+        case CFI_RULE_OFFSET:
+          if (!ReadStack(cfa + rule.value, &caller[i]))
+            return false;
+          break;
+        case CFI_RULE_VAL_OFFSET:
+          caller[i] = cfa + rule.value;
+          break;
+        case CFI_RULE_REGISTER:
+          if (rule.value < 0 || rule.value >= CFI_X64_REGISTER_COUNT)
+            return false;
+          caller[i] = regs[rule.value];
+          break;
+      }
+    }
+    caller[CFI_X64_RSP] = cfa;
+
+    memcpy(regs, caller, sizeof(caller));
+    return true;
+  }
+
+  const UnwindModule* FindModule(guint64 address) const {
+    UnwindModule key;
+    key.base = address;
+    auto upper = std::upper_bound(modules_.begin(), modules_.end(), key);
+    if (upper == modules_.begin())
+      return NULL;
+    auto& module = *(upper - 1);
+    if (address - module.base >= module.size)
+      return NULL;
+    return &module;
+  }
+
+  bool ReadStack(guint64 address, guint64* value) const {
+    if (address < stack_base_ || address - stack_base_ > stack_size_ ||
+        stack_size_ - (address - stack_base_) < 8)
+      return false;
+    *value = ReadU64(STACK_CAPTURE_HEADER_SIZE + (address - stack_base_));
+    return true;
+  }
+
+  guint32 ReadU32(gsize offset) const {
+    guint32 value;
+    memcpy(&value, blob_.data() + offset, sizeof(value));
+    return GUINT32_FROM_LE(value);
+  }
+
+  guint64 ReadU64(gsize offset) const {
+    guint64 value;
+    memcpy(&value, blob_.data() + offset, sizeof(value));
+    return GUINT64_FROM_LE(value);
+  }
+
+  std::vector<char> blob_;
+  std::vector<UnwindModule> modules_;
+  guint max_frames_;
+  guint64 stack_base_;
+  guint64 stack_size_;
+  std::vector<guint64> frames_;
+};
+
+void Unwinder::Init(Handle<Object> exports, Runtime* runtime) {
+  auto name = Nan::New("unwindStack").ToLocalChecked();
+  auto tpl = Nan::New<v8::FunctionTemplate>(UnwindStack,
+      Nan::New<External>(runtime));
+  Nan::Set(exports, name, Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+NAN_METHOD(Unwinder::UnwindStack) {
+  auto isolate = info.GetIsolate();
+  auto runtime = static_cast<Runtime*>(info.Data().As<External>()->Value());
+
+  if (info.Length() < 3 || !node::Buffer::HasInstance(info[0]) ||
+      !info[1]->IsArray() || !info[2]->IsNumber()) {
+    Nan::ThrowTypeError("Bad argument, expected a stack, modules and a "
+        "frame limit");
+    return;
+  }
+  auto blob = info[0];
+  auto max_frames = info[2]->Uint32Value();
+
+  std::vector<UnwindModule> modules;
+  auto list = Local<Array>::Cast(info[1]);
+  for (uint32_t i = 0; i != list->Length(); i++) {
+    auto entry = Nan::Get(list, i).ToLocalChecked();
+    if (!entry->IsArray()) {
+      Nan::ThrowTypeError("Bad argument, expected [path, base, size] entries");
+      return;
+    }
+    auto fields = Local<Array>::Cast(entry);
+    Nan::Utf8String path(Nan::Get(fields, 0).ToLocalChecked());
+    Nan::Utf8String base(Nan::Get(fields, 1).ToLocalChecked());
+    auto size = Nan::Get(fields, 2).ToLocalChecked();
+    if (*path == NULL || *base == NULL || !size->IsNumber()) {
+      Nan::ThrowTypeError("Bad argument, expected [path, base, size] entries");
+      return;
+    }
+    UnwindModule module;
+    module.path = *path;
+    auto build_id = Nan::Get(fields, 3).ToLocalChecked();
+    if (build_id->IsString())
+      module.build_id = *Nan::Utf8String(build_id);
+    module.base = g_ascii_strtoull(*base, NULL, 0);
+    module.size = static_cast<guint64>(size->NumberValue());
+    modules.push_back(module);
+  }
+
+  auto work = new UnwindStackWork(node::Buffer::Data(blob),
+      node::Buffer::Length(blob), std::move(modules), max_frames);
+  work->Schedule(isolate, runtime);
+  info.GetReturnValue().Set(work->GetPromise(isolate));
+}
+
+}
@@ -0,0 +1,23 @@
+#ifndef FRIDANODE_UNWINDER_H
+#define FRIDANODE_UNWINDER_H
+
+#include "runtime.h"
+
+#include <nan.h>
+
+namespace frida {
+
+// Unwinds stacks captured by the agent's captureStack() shim: registers
+// plus a bounded copy of the stack, walked on the host using the modules'
+// .eh_frame from disk. x86-64 ELF only.
+class Unwinder {
+ public:
+  static void Init(v8::Handle<v8::Object> exports, Runtime* runtime);
+
+ private:
+  static NAN_METHOD(UnwindStack);
+};
+
+}
+
+#endif
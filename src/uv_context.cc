@@ -20,7 +20,10 @@ using Nan::HandleScope;
 
 namespace frida {
 
-UVContext::UVContext(uv_loop_t* loop) : usage_count_(0), pending_(NULL) {
+UVContext::UVContext(uv_loop_t* loop)
+    : loop_(loop),
+      usage_count_(0),
+      pending_(NULL) {
   uv_async_init(loop, &async_, ProcessPendingWrapper);
   uv_unref(reinterpret_cast<uv_handle_t*>(&async_));
   async_.data = this;
@@ -46,6 +49,10 @@ UVContext::~UVContext() {
   uv_close(reinterpret_cast<uv_handle_t*>(&async_), NULL);
 }
 
+uv_loop_t* UVContext::GetLoop() const {
+  return loop_;
+}
+
 void UVContext::IncreaseUsage() {
   if (++usage_count_ == 1)
     uv_ref(reinterpret_cast<uv_handle_t*>(&async_));
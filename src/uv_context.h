@@ -14,6 +14,8 @@ public:
   UVContext(uv_loop_t* handle);
   ~UVContext();
 
+  uv_loop_t* GetLoop() const;
+
   void IncreaseUsage();
   void DecreaseUsage();
 
@@ -25,6 +27,7 @@ private:
   static void ProcessPendingWrapper(const v8::FunctionCallbackInfo<v8::Value>& info);
   static void ProcessPendingWrapper(uv_async_t* handle);
 
+  uv_loop_t* loop_;
   int usage_count_;
   uv_async_t async_;
   GMutex mutex_;
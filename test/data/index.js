@@ -9,3 +9,31 @@ function targetProgram() {
 }
 
 module.exports.targetProgram = targetProgram();
+
+/*
+ * Runs `source` in a child Node with --expose-gc and resolves once it exits
+ * by itself, i.e. once nothing frida-related keeps its loop alive anymore.
+ */
+function exitsOnItsOwn(source, timeout) {
+  var spawn = require('child_process').spawn;
+  var prelude = 'var frida = require(' +
+      JSON.stringify(require('path').join(__dirname, '..', '..')) + ');';
+  return new Promise(function (resolve, reject) {
+    var child = spawn(process.execPath, ['--expose-gc', '-e', prelude + source], {
+      stdio: 'inherit'
+    });
+    var timer = setTimeout(function () {
+      child.kill('SIGKILL');
+      reject(new Error('Process was kept alive'));
+    }, timeout);
+    child.on('exit', function (code) {
+      clearTimeout(timer);
+      if (code === 0)
+        resolve();
+      else
+        reject(new Error('Process exited with code ' + code));
+    });
+  });
+}
+
+module.exports.exitsOnItsOwn = exitsOnItsOwn;
@@ -2,6 +2,7 @@
 
 /* global describe, afterEach, gc, it */
 
+var data = require('./data');
 var frida = require('..');
 var should = require('should');
 
@@ -19,6 +20,16 @@ describe('Device', function () {
     });
   });
 
+  it('should disconnect a weak listener once it is collected', function () {
+    this.timeout(10000);
+    // A 'spawned' listener keeps the loop alive until it is disconnected.
+    return data.exitsOnItsOwn(
+      'frida.getLocalDevice().then(function (device) {' +
+        'device.events.listen("spawned", function () {}, { weak: true });' +
+        'setImmediate(gc);' +
+      '});', 5000);
+  });
+
   it('should enumerate processes', function () {
     return frida.getLocalDevice()
     .then(function (device) {
@@ -32,4 +43,62 @@ describe('Device', function () {
       process.name.should.be.an.instanceof(String);
     });
   });
+
+  it('should enumerate processes without icons', function () {
+    return frida.getLocalDevice()
+    .then(function (device) {
+      return device.enumerateProcesses({ scope: 'minimal' });
+    })
+    .then(function (processes) {
+      processes.length.should.be.above(0);
+      var process = processes[0];
+      process.should.have.properties('pid', 'name');
+      process.should.not.have.properties('smallIcon', 'largeIcon');
+      process.pid.should.be.an.instanceof(Number);
+      process.name.should.be.an.instanceof(String);
+    });
+  });
+
+  it('should report the frontmost application once until it changes', function () {
+    return frida.getLocalDevice()
+    .then(function (device) {
+      return new Promise(function (resolve, reject) {
+        var changes = [];
+        var timer = setTimeout(function () {
+          watcher.stop();
+          reject(new Error('Nothing was reported'));
+        }, 5000);
+        var watcher = device.watchFrontmostApplication(function (application) {
+          changes.push(application);
+          if (changes.length === 1) {
+            // Plenty of ticks at a 10 ms interval to catch repeats.
+            clearTimeout(timer);
+            setTimeout(function () {
+              watcher.stop();
+              resolve(changes);
+            }, 500);
+          }
+        }, { interval: 10 });
+      });
+    })
+    .then(function (changes) {
+      changes.length.should.be.above(0);
+      for (var i = 1; i < changes.length; i++)
+        changes[i].should.not.eql(changes[i - 1]);
+    });
+  });
+
+  it('should support aborting operations', function () {
+    return frida.getLocalDevice()
+    .then(function (device) {
+      var operation = device.enumerateProcesses();
+      operation.should.have.property('abort');
+      operation.abort();
+      return operation.then(function () {
+        throw new Error('Should not succeed');
+      }, function (error) {
+        error.message.should.equal('Operation was cancelled');
+      });
+    });
+  });
 });
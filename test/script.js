@@ -4,12 +4,14 @@
 
 var data = require('./data');
 var frida = require('..');
+var fragmentation = require('../lib/fragmentation');
 var should = require('should');
 var spawn = require('child_process').spawn;
 
 describe('Script', function () {
   var target;
   var session;
+  var reachable = [];
 
   before(function () {
     target = spawn(data.targetProgram, [], {
@@ -80,4 +82,232 @@ describe('Script', function () {
       console.error(error.message);
     });
   });
+
+  it('should filter messages before delivery', function (done) {
+    session.createScript(
+      'send({ kind: "tick", n: 1 });' +
+      'send({ kind: "tock", n: 2 });' +
+      'send({ kind: "tick", n: 3 }, Memory.readByteArray(Memory.alloc(1), 1));' +
+      'send({ kind: "done" });')
+    .then(function (script) {
+      var received = [];
+      script.events.listen('message', function (message) {
+        received.push(message.payload.n);
+      }, {
+        filter: { type: 'send', payload: { kind: 'tick' }, hasData: false }
+      });
+      script.events.listen('message', function (message) {
+        received.should.eql([1]);
+        done();
+      }, {
+        filter: { payload: { kind: { in: ['done'] } } }
+      });
+      return script.load();
+    })
+    .catch(done);
+  });
+
+  it('should support typed rpc signatures', function () {
+    var script, exp;
+    return session.createScript(
+      '"use strict";' +
+      'rpc.exports = {' +
+        'add(a, b) {' +
+          'return a + b;' +
+        '},' +
+        'measure(base, buf, label) {' +
+          'return base + buf.byteLength + label.length;' +
+        '},' +
+        'greet(name) {' +
+          'return "Hello " + name;' +
+        '}' +
+      '};' +
+      'rpc.signatures = {' +
+        'add: "(i32, i32) -> i32",' +
+        'measure: "(u64, buffer, string) -> u64"' +
+      '};', { typedRpc: true })
+    .then(function (s) {
+      script = s;
+      return script.load();
+    })
+    .then(function () {
+      return script.getExports();
+    })
+    .then(function (e) {
+      exp = e;
+      return exp.add(2, -5);
+    })
+    .then(function (result) {
+      result.should.equal(-3);
+      return exp.measure(1000, new Buffer([1, 2, 3]), 'abcd');
+    })
+    .then(function (result) {
+      result.toJSNumber().should.equal(1007);
+      return exp.add(1);
+    })
+    .then(function () {
+      throw new Error('Should not get here');
+    }, function (error) {
+      error.message.should.equal('Expected 2 argument(s)');
+      return exp.greet('you');
+    })
+    .then(function (result) {
+      result.should.equal('Hello you');
+      return script.unload();
+    });
+  });
+
+  it('should unpack batched messages transparently', function (done) {
+    session.createScript(
+      '"use strict";' +
+      'send({ kind: "tick", n: 1 });' +
+      'send({ kind: "tock", n: 2 });' +
+      'send({ kind: "tick", n: 3 }, Memory.readByteArray(Memory.alloc(1), 1));' +
+      'send({ kind: "done" });', { batch: true })
+    .then(function (script) {
+      var all = [];
+      var ticks = [];
+      script.events.listen('message', function (message, data) {
+        all.push(message.payload.kind);
+      });
+      script.events.listen('message', function (message, data) {
+        ticks.push([message.payload.n, data.length]);
+      }, {
+        filter: { payload: { kind: 'tick' } }
+      });
+      script.events.listen('message', function () {
+        all.should.eql(['tick', 'tock', 'tick', 'done']);
+        ticks.should.eql([[1, 0], [3, 1]]);
+        done();
+      }, {
+        filter: { payload: { kind: 'done' } }
+      });
+      return script.load();
+    })
+    .catch(done);
+  });
+
+  it('should reassemble fragmented messages in order', function (done) {
+    session.createScript(
+      '"use strict";' +
+      'const block = Memory.alloc(10000);' +
+      'send({ kind: "big", text: new Array(3001).join("a") },' +
+        'Memory.readByteArray(block, 10000));' +
+      'send({ kind: "small" });', { fragmentSize: 1024 })
+    .then(function (script) {
+      var received = [];
+      script.events.listen('message', function (message, data) {
+        received.push([message.payload.kind, data.length]);
+        if (message.payload.kind === 'small') {
+          received.should.eql([['big', 10000], ['small', 0]]);
+          done();
+        }
+      });
+      return script.load();
+    })
+    .catch(done);
+  });
+
+  it('should drop partial messages that exceed the reassembly limits', function (done) {
+    var reassembler = new fragmentation.Reassembler({
+      maxPendingBytes: 16,
+      maxPendingAge: 50
+    });
+    should(reassembler.add(['frida:fragment', 1, 0, 2, '{"a":'], new Buffer(0))).be.null();
+    should(reassembler.add(['frida:fragment', 2, 0, 2, '{"b":'], new Buffer(8))).be.null();
+    Object.keys(reassembler.pending).should.eql(['2']);
+    should(reassembler.add(['frida:fragment', 1, 1, 2, '1}'], new Buffer(0))).be.null();
+    setTimeout(function () {
+      should(reassembler.add(['frida:fragment', 3, 0, 2, '{"c":'], new Buffer(0))).be.null();
+      Object.keys(reassembler.pending).should.eql(['3']);
+      reassembler.pendingBytes.should.equal(5);
+      reassembler.clear();
+      Object.keys(reassembler.pending).should.eql([]);
+      reassembler.pendingBytes.should.equal(0);
+      done();
+    }, 100);
+  });
+
+  it('should support fire-and-forget posting', function (done) {
+    session.createScript(
+      'recv(function (message) {' +
+        'send(message.n * 2);' +
+      '});')
+    .then(function (script) {
+      script.events.listen('message', function (message) {
+        message.payload.should.equal(42);
+        done();
+      });
+      return script.load().then(function () {
+        should(script.post({ n: 21 })).be.undefined();
+      });
+    })
+    .catch(done);
+  });
+
+  it('should keep weak listeners while the script is reachable', function (done) {
+    session.createScript(
+      'function onMessage(message) {' +
+        'send({ answer: message.n });' +
+        'recv(onMessage);' +
+      '}' +
+      'recv(onMessage);')
+    .then(function (script) {
+      var answers = [];
+      reachable.push(script);
+      // Nothing but the script references this callback.
+      script.events.listen('message', function (message) {
+        answers.push(message.payload.answer);
+        if (answers.length === 3) {
+          answers.should.eql([1, 2, 3]);
+          reachable.splice(reachable.indexOf(script), 1);
+          done();
+          return;
+        }
+        gc();
+        script.post({ n: answers.length + 1 });
+      }, { weak: true });
+      gc();
+      return script.load().then(function () {
+        gc();
+        script.post({ n: 1 });
+      });
+    })
+    .catch(done);
+  });
+
+  it('should let an unreferenced script and its session be collected', function () {
+    this.timeout(10000);
+    // Loaded scripts and attached sessions keep the loop alive until they
+    // are destroyed or collected.
+    return data.exitsOnItsOwn(
+      'frida.attach(' + target.pid + ').then(function (session) {' +
+        'return session.createScript("send(1);").then(function (script) {' +
+          'script.events.listen("message", function () {}, { weak: true });' +
+          'return script.load();' +
+        '});' +
+      '})' +
+      '.then(function () {' +
+        'setImmediate(gc);' +
+        'setTimeout(gc, 100);' +
+      '})' +
+      '.catch(function (error) {' +
+        'console.error(error);' +
+        'process.exit(1);' +
+      '});', 5000);
+  });
+
+  it('should deliver lazily parsed messages', function (done) {
+    session.createScript('send({ answer: 42 });')
+    .then(function (script) {
+      script.events.listen('message', function (message) {
+        message.type.should.equal('send');
+        message.rawPayload.should.equal('{"answer":42}');
+        message.payload.answer.should.equal(42);
+        done();
+      }, { lazy: true });
+      return script.load();
+    })
+    .catch(done);
+  });
 });
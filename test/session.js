@@ -4,6 +4,8 @@
 
 var data = require('./data');
 var frida = require('..');
+var os = require('os');
+var path = require('path');
 var should = require('should');
 var spawn = require('child_process').spawn;
 
@@ -55,6 +57,43 @@ describe('Session', function () {
     });
   });
 
+  it('should resolve module exports consistently across sessions', function () {
+    var other;
+    return frida.attach(target.pid)
+    .then(function (s) {
+      other = s;
+      return Promise.all([session.enumerateModules(), other.enumerateModules()]);
+    })
+    .then(function (results) {
+      var a = results[0][1];
+      var b = results[1][1];
+      a.path.should.equal(b.path);
+      return Promise.all([a.enumerateExports(), b.enumerateExports()]);
+    })
+    .then(function (results) {
+      results[0].length.should.equal(results[1].length);
+      results[0][0].name.should.equal(results[1][0].name);
+      results[0][0].absoluteAddress.equals(results[1][0].absoluteAddress)
+          .should.equal(true);
+      return other.detach();
+    });
+  });
+
+  it('should warm up caches until detached', function () {
+    return frida.attach(target.pid, { warmup: { exports: 1 } })
+    .then(function (s) {
+      var warmups = [s.warmedUp, s.warmUp()];
+      s.detach();
+      return Promise.all(warmups.map(function (warmup) {
+        return warmup.then(function () {
+          throw new Error('Should not get here');
+        }, function (error) {
+          error.message.should.equal('Session detached');
+        });
+      }));
+    });
+  });
+
   it('should enumerate ranges', function () {
     session.should.have.property('enumerateRanges');
     return session.enumerateRanges('r--').then(function (ranges) {
@@ -77,6 +116,148 @@ describe('Session', function () {
     });
   });
 
+  it('should take a census of the process', function () {
+    return session.census({ ranges: 'r-x' }).then(function (census) {
+      census.modules.length.should.be.above(0);
+      census.modules[0].should.have.properties('name', 'baseAddress', 'size', 'path');
+      census.ranges.length.should.be.above(0);
+      census.ranges[0].protection.should.match(/^r.x$/);
+      census.threads.length.should.be.above(0);
+      census.threads[0].should.have.properties('id', 'state', 'pc', 'sp');
+    });
+  });
+
+  it('should unwind captured stacks on the host', function (done) {
+    session.createScript(
+      '"use strict";' +
+      'const context = Process.enumerateThreadsSync()[0].context;' +
+      'send(context.pc.toString(), captureStack(context));', { stacks: true })
+    .then(function (script) {
+      script.events.listen('message', function (message, data) {
+        session.unwind(data, { maxFrames: 8 })
+        .then(function (frames) {
+          frames.length.should.be.above(1);
+          frames.length.should.not.be.above(8);
+          frames[0].equals(frida.ptr(message.payload)).should.equal(true);
+          done();
+        })
+        .catch(done);
+      });
+      return script.load();
+    })
+    .catch(done);
+  });
+
+  it('should inspect the malloc heap', function () {
+    return session.enumerateModules().then(function (modules) {
+      var libc = modules.filter(function (m) {
+        return /^libc[.-]/.test(m.name);
+      })[0];
+      return session.enumerateExports(libc.name);
+    })
+    .then(function (exports) {
+      var malloc = exports.filter(function (e) {
+        return e.name === 'malloc';
+      })[0];
+      // A 200 byte request is served from a 208 byte chunk.
+      return session.call(malloc.address, 'pointer (ulong)', [200]);
+    })
+    .then(function () {
+      return session.inspectHeap({ chunkSize: 4096 });
+    })
+    .then(function (heap) {
+      heap.arenas.should.be.above(0);
+      heap.chunks.should.equal(heap.inUse + heap.free);
+      heap.classes.inUse.length.should.equal(heap.classes.sizes.length);
+      var index = heap.classes.sizes.indexOf(208);
+      index.should.not.equal(-1);
+      heap.classes.inUse[index].should.be.above(0);
+      heap.fragmentation.should.be.within(0, 1);
+    });
+  });
+
+  it('should find references to an address', function () {
+    var arena, target, holder;
+    return session.createArena()
+    .then(function (a) {
+      arena = a;
+      target = arena.allocBytes([1, 2, 3, 4]);
+      holder = arena.alloc(8);
+      var pointer = new Buffer(8);
+      frida.ptr.toBuffer(target.add(2), pointer, 0);
+      return arena.flush().then(function () {
+        return session.writeBytes(holder,
+            Array.prototype.slice.call(pointer));
+      });
+    })
+    .then(function () {
+      return session.findReferences([{ address: target, size: 4 }]);
+    })
+    .then(function (references) {
+      references.filter(function (r) {
+        return r.address.equals(holder);
+      }).length.should.equal(1);
+      return arena.release();
+    });
+  });
+
+  it('should stream strings out of memory', function () {
+    var arena, ascii, wide;
+    return session.createArena()
+    .then(function (a) {
+      arena = a;
+      ascii = arena.allocUtf8String('needle in a haystack');
+      wide = arena.allocBytes(new Buffer('wide needle\0', 'utf16le'));
+      return arena.flush();
+    })
+    .then(function () {
+      return new Promise(function (resolve, reject) {
+        var found = [];
+        session.extractStrings([{ baseAddress: ascii, size: 64 }, {
+          baseAddress: wide, size: 24
+        }], { minLength: 6 })
+        .on('data', function (s) {
+          found.push([s.encoding, s.string]);
+        })
+        .on('end', function () {
+          resolve(found);
+        })
+        .on('error', reject);
+      });
+    })
+    .then(function (found) {
+      found.should.containEql(['ascii', 'needle in a haystack']);
+      found.should.containEql(['utf16le', 'wide needle']);
+      return arena.release();
+    });
+  });
+
+  it('should only transfer unknown pages into a snapshot store', function () {
+    var store = new frida.SnapshotStore(path.join(os.tmpdir(),
+        'frida-snapshots-' + process.pid));
+    var first;
+    return session.snapshot(store, { ranges: 'r-x', name: 'first' })
+    .then(function (stats) {
+      first = stats;
+      stats.pages.should.be.above(0);
+      stats.transferred.should.be.within(1, stats.pages);
+      return session.snapshot(store, { ranges: 'r-x', name: 'second' });
+    })
+    .then(function (stats) {
+      stats.pages.should.equal(first.pages);
+      stats.transferred.should.be.below(first.transferred);
+      return store.readManifest('second');
+    })
+    .then(function (manifest) {
+      manifest.pid.should.equal(target.pid);
+      manifest.ranges.length.should.be.above(0);
+      return store.readObject(manifest.ranges[0].pages[0]);
+    })
+    .then(function (page) {
+      page.length.should.be.above(0);
+    });
+  });
+
   it('should find base address', function () {
     session.should.have.property('findBaseAddress');
     return session.enumerateModules().then(function (modules) {
@@ -155,6 +336,149 @@ describe('Session', function () {
     });
   });
 
+  it('should call functions in the target', function () {
+    return session.enumerateModules().then(function (modules) {
+      var libc = modules.filter(function (m) {
+        return /^libc[.-]/.test(m.name);
+      })[0];
+      return session.enumerateExports(libc.name);
+    })
+    .then(function (exports) {
+      var getpid = exports.filter(function (e) {
+        return e.name === 'getpid';
+      })[0];
+      return session.call(getpid.address, 'int ()', [])
+      .then(function (pid) {
+        pid.should.equal(target.pid);
+        var call = { address: getpid.address, signature: 'int ()', args: [] };
+        return session.callMany([call, call, call]);
+      });
+    })
+    .then(function (results) {
+      results.should.be.an.instanceof(Int32Array);
+      Array.prototype.slice.call(results).should.eql(
+          [target.pid, target.pid, target.pid]);
+    });
+  });
+
+  it('should allocate and populate memory through an arena', function () {
+    var arena, hello, bytes;
+    return session.createArena({ size: 4096 })
+    .then(function (a) {
+      arena = a;
+      hello = arena.allocUtf8String('Hello');
+      bytes = arena.allocBytes([1, 2, 3]);
+      return arena.flush();
+    })
+    .then(function () {
+      return session.readUtf8(hello);
+    })
+    .then(function (string) {
+      string.should.equal('Hello');
+      return session.readBytes(bytes, 3);
+    })
+    .then(function (data) {
+      Array.prototype.slice.call(data).should.eql([1, 2, 3]);
+      return arena.release();
+    });
+  });
+
+  it('should apply and roll back batched patches', function () {
+    var arena, block, patch;
+    return session.createArena()
+    .then(function (a) {
+      arena = a;
+      block = arena.allocBytes([1, 2, 3, 4]);
+      return arena.flush();
+    })
+    .then(function () {
+      return session.patch([
+        { address: block.add(2), bytes: [0xcc] },
+        { address: block, bytes: new Buffer([0x90]) }
+      ]);
+    })
+    .then(function (p) {
+      patch = p;
+      patch.pageCount.should.equal(1);
+      return session.readBytes(block, 4);
+    })
+    .then(function (data) {
+      Array.prototype.slice.call(data).should.eql([0x90, 2, 0xcc, 4]);
+      return session.writeBytes(block.add(1), [0x42]);
+    })
+    .then(function () {
+      return patch.rollback();
+    })
+    .then(function () {
+      return session.readBytes(block, 4);
+    })
+    .then(function (data) {
+      Array.prototype.slice.call(data).should.eql([1, 0x42, 3, 4]);
+      return arena.release();
+    });
+  });
+
+  it('should profile function latency', function () {
+    return session.enumerateModules().then(function (modules) {
+      var libc = modules.filter(function (m) {
+        return /^libc[.-]/.test(m.name);
+      })[0];
+      return session.enumerateExports(libc.name);
+    })
+    .then(function (exports) {
+      var read = exports.filter(function (e) {
+        return e.name === 'read';
+      })[0];
+      return session.profileLatency([read.address], { interval: 50 });
+    })
+    .then(function (profiler) {
+      return profiler.stop();
+    })
+    .then(function (stats) {
+      stats.length.should.equal(1);
+      stats[0].should.have.properties('count', 'p50', 'p99', 'max', 'threads');
+    });
+  });
+
+  it('should profile lock contention', function () {
+    return session.profileLocks({ interval: 50 })
+    .then(function (profiler) {
+      return profiler.stop({ limit: 5 });
+    })
+    .then(function (locks) {
+      locks.should.be.an.instanceof(Array);
+      locks.length.should.not.be.above(5);
+    });
+  });
+
+  it('should stream uploads into target memory', function () {
+    var payload = new Buffer(200 * 1024);
+    for (var i = 0; i !== payload.length; i++)
+      payload[i] = i & 0xff;
+
+    var arena, block;
+    return session.createArena({ size: payload.length })
+    .then(function (a) {
+      arena = a;
+      block = arena.alloc(payload.length);
+      return new Promise(function (resolve, reject) {
+        var upload = session.createUploadStream(block, {
+          size: payload.length
+        });
+        upload.on('finish', resolve);
+        upload.on('error', reject);
+        upload.end(payload);
+      });
+    })
+    .then(function () {
+      return session.readBytes(block, payload.length);
+    })
+    .then(function (data) {
+      data.equals(payload).should.equal(true);
+      return arena.release();
+    });
+  });
+
   it('should act as a function container', function () {
     return session.enumerateModules().then(function (modules) {
       var m = modules[1];